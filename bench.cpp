@@ -0,0 +1,538 @@
+// Benchmarks for the server's hot paths.
+//
+// Build: g++ -std=c++20 -O2 bench.cpp -o bench -lcrypto -pthread
+// Run:   ./bench [maxRows] [--threads N] [--out FILE]
+//
+// The server is compiled in directly so the benchmark exercises the real code.
+// Every benchmark runs on synthetic data at 10^3, 10^4, ... up to maxRows
+// (default 10^5) trips or bookings, once on one thread and once with N threads
+// (default 4) hammering the same data. Tables go to stdout; every measurement
+// is also written as one JSON object per line to FILE (default bench.jsonl),
+// in a fixed order, so the results of two builds can be diffed directly.
+//
+// The stores write their files (seats.bin, bookings.txt, trips.txt) into the
+// current directory, so the run happens in a scratch directory under /tmp.
+#define BUS_SERVER_NO_MAIN
+#include "newserver.cpp"
+
+#include <chrono>
+#include <filesystem>
+#include <latch>
+
+// The line-by-line stringstream parser that CsvFile replaced, kept as the baseline
+vector<vector<string>> legacyReadFile(const string &filename)
+{
+    vector<vector<string>> data;
+    ifstream file(filename);
+    string line;
+    while (getline(file, line))
+    {
+        stringstream ss(line);
+        vector<string> row;
+        string cell;
+        while (getline(ss, cell, ','))
+            row.push_back(cell);
+        data.push_back(row);
+    }
+    return data;
+}
+
+// Best wall time of `reps` runs, in milliseconds
+template <typename F>
+double bestOf(int reps, F f)
+{
+    double best = 1e300;
+    for (int i = 0; i < reps; ++i)
+    {
+        auto t0 = chrono::steady_clock::now();
+        f();
+        best = min(best, chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count());
+    }
+    return best;
+}
+
+// Wall time of `threads` threads running f(thread index) together, in
+// milliseconds; the clock starts once every thread is ready to go
+template <typename F>
+double inParallel(int threads, F f)
+{
+    latch ready(threads + 1), go(1);
+    vector<thread> pool;
+    for (int t = 0; t < threads; ++t)
+        pool.emplace_back([&, t] {
+            ready.count_down();
+            go.wait();
+            f(t);
+        });
+    ready.arrive_and_wait();
+    auto t0 = chrono::steady_clock::now();
+    go.count_down();
+    for (auto &th : pool)
+        th.join();
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+}
+
+// --- RESULTS ---
+
+struct BenchResult
+{
+    string bench;
+    long long scale;    // trips or bookings in the data set
+    int threads;
+    long long ops;      // operations completed
+    double ms;          // wall time for all of them
+    long long lost;     // attempts that lost a race, timed but not counted in ops
+};
+
+vector<BenchResult> results;
+
+// Records one measurement and returns its cost per operation in nanoseconds
+double record(const string &bench, long long scale, int threads, long long ops, double ms, long long lost = 0)
+{
+    results.push_back({bench, scale, threads, ops, ms, lost});
+    return ms * 1e6 / max(ops, 1LL);
+}
+
+bool writeResults(const string &filename)
+{
+    ofstream out(filename);
+    for (auto &r : results)
+    {
+        out << JsonObject()
+                   .addString("bench", r.bench)
+                   .addNumber("scale", r.scale)
+                   .addNumber("threads", r.threads)
+                   .addNumber("ops", r.ops)
+                   .addNumber("ms", r.ms)
+                   .addNumber("ns_per_op", r.ms * 1e6 / max(r.ops, 1LL))
+                   .addNumber("lost", r.lost)
+                   .str() << "\n";
+    }
+    return bool(out);
+}
+
+// lost < 0 leaves out the column for benchmarks where no attempt can lose
+void printRow(long long rows, double single, double contended, long long lost = -1)
+{
+    cout << setw(10) << rows << setw(16) << fixed << setprecision(1) << single
+         << setw(16) << contended << setw(9) << setprecision(2) << single / contended << "x";
+    if (lost >= 0)
+        cout << setw(12) << lost;
+    cout << "\n";
+}
+
+void printHeader(const string &title, int threads, bool lostColumn = false)
+{
+    cout << "\n" << title << "\n";
+    cout << setw(10) << "rows" << setw(16) << "1 thread ns/op" << setw(16) << (to_string(threads) + " threads ns/op")
+         << setw(10) << "scaling";
+    if (lostColumn)
+        cout << setw(12) << "lost races";
+    cout << "\n";
+}
+
+// --- SYNTHETIC DATA ---
+
+// users.txt-shaped file; every tenth name needs quoting
+string makeUsersFile(int rows)
+{
+    string filename = "bench_users_" + to_string(rows) + ".txt";
+    ofstream out(filename);
+    char hash[SHA256_DIGEST_LENGTH * 2 + 1];
+    hash_password("secret", hash);
+    for (int i = 0; i < rows; ++i)
+    {
+        char aadhar[13];
+        snprintf(aadhar, sizeof(aadhar), "%012d", i);
+        string name = (i % 10 == 0) ? "Naskar, \"Sutapa\" " + to_string(i) : "User " + to_string(i);
+        out << toCSVLine({aadhar, name, to_string(18 + i % 60), hash});
+    }
+    return filename;
+}
+
+// trips.txt with `rows` trips leaving over the next 30 days, soonest first
+// spread out, so a few fall inside the discount hour
+void makeTripsFile(int rows)
+{
+    ofstream out(TRIPS_FILE, ios::trunc);
+    time_t now = time(nullptr);
+    for (int i = 0; i < rows; ++i)
+    {
+        time_t departs = now + 600 + (long long)i * 30 * 24 * 3600 / rows;
+        char when[64];
+        strftime(when, sizeof(when), "%a %b %d %H:%M:%S %Y", localtime(&departs));
+        char id[16];
+        snprintf(id, sizeof(id), "T%07d", i + 1);
+        out << toCSVLine({id, to_string(100 + i % 50), "Howrah", "Durgapur", "300", "424176487962", when});
+    }
+}
+
+// Seat layouts for `rows` fresh 10x4 buses; returns their trip IDs
+vector<string> makeSeatLayouts(const string &prefix, int rows)
+{
+    vector<SeatLayout> layouts;
+    vector<string> ids;
+    for (int i = 0; i < rows; ++i)
+    {
+        ids.push_back(prefix + to_string(i));
+        layouts.push_back(seatLayoutFor(ids.back(), 10, 4, 300));
+    }
+    if (!seatStore.createMany(layouts))
+        cerr << "❌ could not create seat layouts " << prefix << "\n";
+    return ids;
+}
+
+const int BENCH_BUS_SEATS = 40;
+
+// A session whose output is read and thrown away by a background thread,
+// so seatMatrix() and viewTrips() run exactly as they do for a client
+struct SinkSession
+{
+    int peer = -1;
+    unique_ptr<Session> session;
+    thread drain;
+
+    SinkSession()
+    {
+        int fds[2];
+        socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+        peer = fds[1];
+        session = make_unique<Session>(fds[0], -1);
+        drain = thread([fd = peer] {
+            char buffer[65536];
+            while (read(fd, buffer, sizeof(buffer)) > 0)
+                ;
+        });
+    }
+    ~SinkSession()
+    {
+        session.reset();    // closes our end, so the drain sees EOF
+        drain.join();
+        close(peer);
+    }
+};
+
+// --- BENCHMARKS ---
+
+// The contended column is the wall time of every thread loading its own copy
+// at once, as when the stores load side by side
+void benchCsv(int maxRows, int threads)
+{
+    cout << "readFile vs CsvFile: load the file and look up the last Aadhar (isAadharExist)\n";
+    cout << setw(10) << "rows" << setw(16) << "readFile ms" << setw(16) << "CsvFile ms" << setw(10) << "speedup"
+         << setw(16) << (to_string(threads) + " thr CsvFile") << "\n";
+
+    for (int rows = 1000; rows <= maxRows; rows *= 10)
+    {
+        string filename = makeUsersFile(rows);
+        char last[13];
+        snprintf(last, sizeof(last), "%012d", rows - 1);
+        string key = last;
+        int reps = rows >= 1000000 ? 3 : 10;
+
+        bool foundOld = false, foundNew = false;
+        double oldMs = bestOf(reps, [&] {
+            foundOld = false;
+            for (const auto &row : legacyReadFile(filename))
+                if (!row.empty() && row[0] == key)
+                    foundOld = true;
+        });
+        auto lookUp = [&] {
+            CsvFile users;
+            users.load(filename);
+            for (auto row : users)
+                if (!row.empty() && row[0] == key)
+                    return true;
+            return false;
+        };
+        double newMs = bestOf(reps, [&] { foundNew = lookUp(); });
+        atomic<int> foundRaced{0};
+        double contendedMs = inParallel(threads, [&](int) {
+            if (lookUp())
+                foundRaced++;
+        });
+
+        if (!foundOld || !foundNew || foundRaced != threads)
+            cerr << "❌ lookup failed for " << rows << " rows\n";
+        record("readFile", rows, 1, 1, oldMs);
+        record("CsvFile", rows, 1, 1, newMs);
+        record("CsvFile", rows, threads, threads, contendedMs);
+        cout << setw(10) << rows << setw(16) << fixed << setprecision(3) << oldMs
+             << setw(16) << newMs << setw(9) << setprecision(1) << oldMs / newMs << "x"
+             << setw(16) << setprecision(3) << contendedMs << "\n";
+        remove(filename.c_str());
+    }
+}
+
+// Every tenth field needs quoting, like the names in users.txt
+void benchEscapeCsv(int maxRows, int threads)
+{
+    printHeader("escapeCSV: escape one field per row", threads);
+    for (int rows = 1000; rows <= maxRows; rows *= 10)
+    {
+        vector<string> fields;
+        for (int i = 0; i < rows; ++i)
+            fields.push_back(i % 10 == 0 ? "Naskar, \"Sutapa\" " + to_string(i) : "User " + to_string(i));
+
+        size_t sink = 0;
+        double singleMs = bestOf(5, [&] {
+            for (auto &f : fields)
+                sink += escapeCSV(f).size();
+        });
+        double contendedMs = inParallel(threads, [&](int) {
+            size_t mine = 0;
+            for (auto &f : fields)
+                mine += escapeCSV(f).size();
+            __atomic_add_fetch(&sink, mine, __ATOMIC_RELAXED);
+        });
+        if (sink == 0)
+            cerr << "❌ escapeCSV produced nothing\n";
+
+        printRow(rows, record("escapeCSV", rows, 1, rows, singleMs),
+                 record("escapeCSV", rows, threads, (long long)rows * threads, contendedMs));
+    }
+}
+
+// Capped at 10^5: the cost per hash does not depend on the scale
+void benchHashPassword(int maxRows, int threads)
+{
+    printHeader("hash_password: SHA-256 of one password", threads);
+    for (int rows = 1000; rows <= min(maxRows, 100000); rows *= 10)
+    {
+        char hash[SHA256_DIGEST_LENGTH * 2 + 1];
+        double singleMs = bestOf(3, [&] {
+            for (int i = 0; i < rows; ++i)
+                hash_password("a strong password", hash);
+        });
+        double contendedMs = inParallel(threads, [&](int) {
+            char mine[SHA256_DIGEST_LENGTH * 2 + 1];
+            for (int i = 0; i < rows; ++i)
+                hash_password("a strong password", mine);
+        });
+
+        printRow(rows, record("hash_password", rows, 1, rows, singleMs),
+                 record("hash_password", rows, threads, (long long)rows * threads, contendedMs));
+    }
+}
+
+// The "Upcoming Trips" list every passenger sees first: all future trips,
+// copied out of the TripStore in departure order
+void benchViewTrips(int maxRows, int threads)
+{
+    printHeader("viewTrips: list every upcoming trip (ns per call)", threads);
+    for (int rows = 1000; rows <= maxRows; rows *= 10)
+    {
+        makeTripsFile(rows);
+        tripStore.load(TRIPS_FILE);
+
+        SinkSession sink;
+        ReservationHandler handler("111111111111");
+        int calls = max(3, 100000 / rows);
+        size_t listed = 0;
+        double singleMs = bestOf(3, [&] {
+            for (int i = 0; i < calls; ++i)
+                listed = handler.viewTrips(*sink.session).size();
+        });
+        double contendedMs = inParallel(threads, [&](int) {
+            ReservationHandler mine("111111111111");
+            for (int i = 0; i < calls; ++i)
+                mine.viewTrips(*sink.session);
+        });
+        if (listed != size_t(rows))
+            cerr << "❌ viewTrips listed " << listed << " of " << rows << " trips\n";
+
+        printRow(rows, record("viewTrips", rows, 1, calls, singleMs),
+                 record("viewTrips", rows, threads, (long long)calls * threads, contendedMs));
+    }
+    remove(TRIPS_FILE.c_str());
+}
+
+// Seat charts: first view of each trip (built from scratch), repeat views
+// of a cached chart, and a view after every booking (patched in place)
+void benchSeatMatrix(int maxRows, int threads)
+{
+    cout << "\nseatMatrix: render and send one trip's seat chart (ns per chart)\n";
+    cout << setw(10) << "trips" << setw(16) << "first view" << setw(16) << "cached" << setw(16) << "after booking"
+         << setw(16) << (to_string(threads) + " thr cached") << "\n";
+    for (int rows = 1000; rows <= maxRows; rows *= 10)
+    {
+        vector<string> trips = makeSeatLayouts("M" + to_string(rows) + "-", rows);
+        SinkSession sink;
+
+        double firstMs = bestOf(1, [&] {
+            for (auto &id : trips)
+                seatMatrix(id, *sink.session);
+        });
+
+        int views = 100000;
+        double cachedMs = bestOf(3, [&] {
+            for (int i = 0; i < views; ++i)
+                seatMatrix(trips[i % trips.size()], *sink.session);
+        });
+
+        // Patch the same trip's chart once per booked seat
+        long long patched = 0;
+        double patchedMs = 0;
+        for (size_t t = 0; t < trips.size() && patched < 10000; ++t)
+            for (int seatNo = 1; seatNo <= BENCH_BUS_SEATS; ++seatNo, ++patched)
+            {
+                seatStore.book(trips[t], seatNo);
+                auto t0 = chrono::steady_clock::now();
+                seatMatrix(trips[t], *sink.session);
+                patchedMs += chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+            }
+
+        // Everybody looking at the same trip at once
+        vector<unique_ptr<SinkSession>> sinks;
+        for (int t = 0; t < threads; ++t)
+            sinks.push_back(make_unique<SinkSession>());
+        int each = views / threads;
+        double contendedMs = inParallel(threads, [&](int t) {
+            for (int i = 0; i < each; ++i)
+                seatMatrix(trips[0], *sinks[t]->session);
+        });
+
+        cout << setw(10) << rows << setw(16) << fixed << setprecision(1)
+             << record("seatMatrix/first", rows, 1, rows, firstMs)
+             << setw(16) << record("seatMatrix/cached", rows, 1, views, cachedMs)
+             << setw(16) << record("seatMatrix/patched", rows, 1, patched, patchedMs)
+             << setw(16) << record("seatMatrix/cached", rows, threads, (long long)each * threads, contendedMs) << "\n";
+    }
+}
+
+// Seat claims, alone (SeatStore::book) and as a full ticket sale with its
+// hold, WAL commit and index update (bookTickets). The contended runs let
+// every thread try every seat in the same order, so each seat is fought over
+// by all of them and must still be sold exactly once. Only the seats won
+// count as operations; the attempts that lost are shown as lost races, since
+// they return before the msync or the commit that a win pays for.
+void benchBooking(int maxRows, int threads)
+{
+    printHeader("SeatStore::book: claim one seat (contended ns per seat won)", threads, true);
+    for (int rows = 1000; rows <= maxRows; rows *= 10)
+    {
+        int buses = (rows + BENCH_BUS_SEATS - 1) / BENCH_BUS_SEATS;
+        vector<string> alone = makeSeatLayouts("A" + to_string(rows) + "-", buses);
+        vector<string> raced = makeSeatLayouts("C" + to_string(rows) + "-", buses);
+        auto seatAt = [&](const vector<string> &trips, int i) {
+            return make_pair(cref(trips[i % buses]), i / buses + 1);
+        };
+
+        int won = 0;
+        double singleMs = bestOf(1, [&] {
+            for (int i = 0; i < rows; ++i)
+            {
+                auto [trip, seatNo] = seatAt(alone, i);
+                won += seatStore.book(trip, seatNo);
+            }
+        });
+        atomic<int> wonRaced{0};
+        double contendedMs = inParallel(threads, [&](int) {
+            for (int i = 0; i < rows; ++i)
+            {
+                auto [trip, seatNo] = seatAt(raced, i);
+                if (seatStore.book(trip, seatNo))
+                    wonRaced++;
+            }
+        });
+        if (won != rows || wonRaced != rows)
+            cerr << "❌ booked " << won << " / " << wonRaced << " of " << rows << " seats\n";
+
+        long long lost = (long long)rows * threads - wonRaced;
+        printRow(rows, record("SeatStore::book", rows, 1, won, singleMs),
+                 record("SeatStore::book", rows, threads, wonRaced, contendedMs, lost), lost);
+    }
+
+    printHeader("bookTickets: hold, claim, commit to the booking log and index one seat (contended ns per seat sold)",
+                threads, true);
+    for (int rows = 1000; rows <= maxRows; rows *= 10)
+    {
+        int buses = (rows + BENCH_BUS_SEATS - 1) / BENCH_BUS_SEATS;
+        vector<string> alone = makeSeatLayouts("B" + to_string(rows) + "-", buses);
+        vector<string> raced = makeSeatLayouts("D" + to_string(rows) + "-", buses);
+
+        const string busNo = "900", aadhar = "111111111111", name = "Sutapa naskar";
+        const vector<float> prices{150.0f};
+        auto sell = [&](const vector<string> &trips, int i) {
+            vector<Booking> bookings;
+            vector<int> seatNos{i / buses + 1};
+            int takenSeat;
+            SeatHold hold;
+            // Without a session the commit is waited for, so this runs to the end
+            Task<BookingOutcome> booking = bookTickets(trips[i % buses], busNo, seatNos, prices, aadhar, name,
+                                                       bookings, takenSeat, hold);
+            booking.start();
+            return booking.get() == BOOKING_OK;
+        };
+
+        int sold = 0;
+        double singleMs = bestOf(1, [&] {
+            for (int i = 0; i < rows; ++i)
+                sold += sell(alone, i);
+        });
+        atomic<int> soldRaced{0};
+        double contendedMs = inParallel(threads, [&](int) {
+            for (int i = 0; i < rows; ++i)
+                if (sell(raced, i))
+                    soldRaced++;
+        });
+        if (sold != rows || soldRaced != rows)
+            cerr << "❌ sold " << sold << " / " << soldRaced << " of " << rows << " seats\n";
+
+        long long lost = (long long)rows * threads - soldRaced;
+        printRow(rows, record("bookTickets", rows, 1, sold, singleMs),
+                 record("bookTickets", rows, threads, soldRaced, contendedMs, lost), lost);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int maxRows = 100000;
+    int threads = 4;
+    string outFile = "bench.jsonl";
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc)
+            threads = max(1, atoi(argv[++i]));
+        else if (arg == "--out" && i + 1 < argc)
+            outFile = argv[++i];
+        else
+            maxRows = atoi(argv[i]);
+    }
+    if (maxRows < 1000)
+    {
+        cerr << "Usage: " << argv[0] << " [maxRows >= 1000] [--threads N] [--out FILE]\n";
+        return 1;
+    }
+
+    // Results land where we were started, the data sets in a scratch directory
+    if (outFile[0] != '/')
+        outFile = filesystem::current_path() / outFile;
+    char scratch[] = "/tmp/busbench.XXXXXX";
+    if (!mkdtemp(scratch) || chdir(scratch) != 0)
+    {
+        perror("[BENCH] scratch directory");
+        return 1;
+    }
+    if (!seatStore.open(SEAT_FILE) || !bookingLog.open(BOOKING_FILE))
+        return 1;
+
+    benchCsv(maxRows, threads);
+    benchEscapeCsv(maxRows, threads);
+    benchHashPassword(maxRows, threads);
+    benchViewTrips(maxRows, threads);
+    benchSeatMatrix(maxRows, threads);
+    benchBooking(maxRows, threads);
+
+    bookingLog.close();
+    filesystem::remove_all(scratch);
+
+    if (!writeResults(outFile))
+    {
+        cerr << "❌ could not write " << outFile << "\n";
+        return 1;
+    }
+    cout << "\n📄 " << results.size() << " results written to " << outFile << "\n";
+    return 0;
+}
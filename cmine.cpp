@@ -5,22 +5,577 @@
 #include <arpa/inet.h>
 #include <cstring>
 #include <signal.h>
+#include <poll.h>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <vector>
+#include <sys/resource.h>
+
+#include "protocol.h"
 using namespace std;
 
 int sock = -1;
 
+// Largest frame we accept from the server (a seat chart is a few KB)
+const size_t MAX_FRAME = 1 << 20;
+
 // Signal handler for Ctrl+C
 void handle_sigint(int sig) {
     cout << "\nCaught Ctrl+C, Disconnecting from the server\n";
     if (sock != -1) {
-        const char* msg = "A client got disconnected\n";
-        send(sock, msg, strlen(msg), 0);
+        // Built by hand: nothing that allocates is safe in a signal handler
+        const char bye[FRAME_HEADER_SIZE] = {FRAME_BYE, 0, 0, 0, 0};
+        send(sock, bye, sizeof(bye), 0);
         close(sock);
     }
     exit(0);
 }
 
-int main() {
+bool sendAll(int fd, const string &data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0)
+            return false;
+        sent += n;
+    }
+    return true;
+}
+
+bool sendAll(const string &data) {
+    return sendAll(sock, data);
+}
+
+// Take the next non-blank line out of typed; false if there is none yet
+bool takeAnswer(string &typed, string &input) {
+    size_t newline;
+    while ((newline = typed.find('\n')) != string::npos) {
+        input = typed.substr(0, newline);
+        typed.erase(0, newline + 1);
+
+        // Trim the input
+        size_t start = input.find_first_not_of(" \t\r\n");
+        if (start == string::npos) {
+            cout << "⚠️  Empty input. Please enter again:\n> " << flush;
+            continue; // prompt again
+        }
+        size_t end = input.find_last_not_of(" \t\r\n");
+        input = input.substr(start, end - start + 1);
+        return true;
+    }
+    return false;
+}
+
+// ---------- LOAD GENERATOR ----------
+//
+// ./c --load N runs N scripted passengers at once instead of reading the
+// keyboard. Each one registers, logs in, browses the trips and books seats
+// by answering the server's prompts, the same way a person would:
+//
+//   ./c --load 1000 [--think MS] [--bookings K] [--host IP] [--port P] [--seed S]
+//
+// Latency is measured per step, from sending an answer until the next prompt
+// arrives, and reported as p50/p99/p999 when every passenger is done. All
+// connections are driven from one poll() loop, so at very high N the numbers
+// include some of the generator's own queueing.
+
+// Log-linear latency histogram in microseconds: exact below 32us, then 16
+// buckets per power of two (within ~6%), so percentiles need no samples kept
+class LatencyHistogram
+{
+    static const int SUB_BUCKETS = 16;
+    vector<uint64_t> counts = vector<uint64_t>(64 * SUB_BUCKETS, 0);
+    uint64_t total = 0, maxSeen = 0;
+
+    static size_t bucketOf(uint64_t us);
+    static uint64_t valueOf(size_t bucket);
+
+public:
+    void record(uint64_t us);
+    uint64_t count() const { return total; }
+    uint64_t max() const { return maxSeen; }
+    uint64_t percentile(double p) const;
+};
+
+size_t LatencyHistogram::bucketOf(uint64_t us)
+{
+    if (us < 2 * SUB_BUCKETS)
+        return us;
+    int exponent = 63 - __builtin_clzll(us);     // us >= 2^exponent
+    uint64_t sub = (us >> (exponent - 4)) & (SUB_BUCKETS - 1);
+    return (exponent - 3) * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::valueOf(size_t bucket)
+{
+    if (bucket < 2 * SUB_BUCKETS)
+        return bucket;
+    int exponent = bucket / SUB_BUCKETS + 3;
+    uint64_t sub = bucket % SUB_BUCKETS;
+    return (uint64_t(SUB_BUCKETS) + sub) << (exponent - 4);
+}
+
+void LatencyHistogram::record(uint64_t us)
+{
+    counts[bucketOf(us)]++;
+    total++;
+    if (us > maxSeen)
+        maxSeen = us;
+}
+
+uint64_t LatencyHistogram::percentile(double p) const
+{
+    if (total == 0)
+        return 0;
+    uint64_t rank = uint64_t(ceil(p / 100.0 * total)), seen = 0;
+    if (rank == 0)
+        rank = 1;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= rank)
+            return min(valueOf(i), maxSeen);
+    }
+    return maxSeen;
+}
+
+using LoadClock = chrono::steady_clock;
+
+struct LoadOptions
+{
+    int users = 0;
+    int thinkMs = 0;          // mean pause before each answer
+    int bookings = 1;         // seats each passenger books
+    string host = "127.0.0.1";
+    int port = 8050;
+    unsigned seed = 0;
+};
+
+// The steps we time, named after the prompt being answered
+enum LoadStep
+{
+    STEP_ROLE, STEP_MENU, STEP_NAME, STEP_AGE, STEP_AADHAR, STEP_PASSWORD,
+    STEP_LOGIN_AADHAR, STEP_LOGIN, STEP_DASHBOARD, STEP_TRIP, STEP_SEAT,
+    STEP_PASSENGER, STEP_PASSENGER_AADHAR, STEP_CONFIRM, STEP_ANOTHER,
+    STEP_COUNT
+};
+
+const char *const LOAD_STEP_NAMES[STEP_COUNT] = {
+    "role", "main menu", "register name", "register age", "register aadhar",
+    "register password", "login aadhar", "login password", "dashboard",
+    "choose trip", "choose seat", "passenger name", "passenger aadhar",
+    "confirm booking", "book another",
+};
+
+// Give up on booking after this many trips in a row had no seat for us
+const int MAX_TRIP_TRIES = 5;
+
+struct LoadStats
+{
+    LatencyHistogram steps[STEP_COUNT];
+    uint64_t answers = 0, sessions = 0, failed = 0;
+    uint64_t booked = 0, conflicts = 0, soldOut = 0;
+};
+
+// One scripted passenger on its own framed connection
+struct LoadUser
+{
+    int fd = -1;
+    string aadhar, name;
+    string pending, context;       // undecoded bytes; messages since the last prompt
+    bool synced = false, done = false;
+
+    bool menuSeen = false;
+    int booked = 0, tripTries = 0;
+    vector<string> trips;          // trip IDs from the last listing
+
+    string answer;                 // decided, waiting for think time to pass
+    LoadClock::time_point answerAt;
+    bool answerDue = false;
+    LoadStep step = STEP_ROLE;     // step the answer in flight belongs to
+    LoadClock::time_point sentAt;
+    bool waiting = false;          // an answer is out, timing the next prompt
+
+    bool wantsSeats(const LoadOptions &options) const
+    {
+        return booked < options.bookings && tripTries < MAX_TRIP_TRIES;
+    }
+};
+
+// Trip IDs from a listing like "1. T014 | 900 | A → B | 20/12/2027 10:00"
+vector<string> parseTripList(const string &text)
+{
+    vector<string> ids;
+    istringstream lines(text);
+    string line;
+    while (getline(lines, line)) {
+        size_t dot = line.find(". ");
+        size_t bar = line.find(" | ");
+        if (dot == string::npos || bar == string::npos || dot > bar || dot == 0)
+            continue;
+        if (line.find_first_not_of("0123456789") != dot)
+            continue;
+        ids.push_back(line.substr(dot + 2, bar - dot - 2));
+    }
+    return ids;
+}
+
+// Free seats from a seat chart: each row is a line of icons followed by a
+// line with the matching seat numbers
+vector<int> parseFreeSeats(const string &text)
+{
+    vector<int> free;
+    istringstream lines(text);
+    string line, icons;
+    bool haveIcons = false;
+    while (getline(lines, line)) {
+        if (line.empty() || line[0] != '|' || line.compare(0, 2, "|=") == 0) {
+            haveIcons = false;
+            continue;
+        }
+        if (!haveIcons) {
+            icons = line;
+            haveIcons = true;
+            continue;
+        }
+        haveIcons = false;
+
+        istringstream iconWords(icons.substr(1)), numberWords(line.substr(1));
+        string icon, number;
+        while (iconWords >> icon && numberWords >> number)
+            if (icon == "💺")
+                free.push_back(atoi(number.c_str()));
+    }
+    return free;
+}
+
+// What this passenger says to a prompt; false if the script has no answer
+bool decideAnswer(LoadUser &user, const string &prompt, const LoadOptions &options,
+                  LoadStats &stats, mt19937 &rng, string &answer, LoadStep &step)
+{
+    // Outcome of the booking we confirmed last
+    if (user.context.find("Booked Successfully") != string::npos) {
+        user.booked++;
+        user.tripTries = 0;
+        stats.booked++;
+    }
+    else if (user.context.find("is either already booked") != string::npos)
+        stats.conflicts++;
+
+    if (prompt.find("ENTER YOUR CHOICE") != string::npos) {
+        answer = "1";                                  // passenger
+        step = STEP_ROLE;
+    }
+    else if (prompt.find("MAIN MENU") != string::npos) {
+        answer = user.menuSeen ? "3" : "1";            // register once, then leave
+        user.menuSeen = true;
+        step = STEP_MENU;
+    }
+    else if (prompt == "Enter your Name:") {
+        answer = user.name;
+        step = STEP_NAME;
+    }
+    else if (prompt == "Enter your Age:") {
+        answer = "30";
+        step = STEP_AGE;
+    }
+    else if (prompt == "Enter your Unique Aadhar number:") {
+        answer = user.aadhar;
+        step = STEP_AADHAR;
+    }
+    else if (prompt.find("Is it a Typo error?") != string::npos) {
+        answer = "n";                                  // left over from an earlier run
+        step = STEP_AADHAR;
+    }
+    else if (prompt == "Enter a Strong Password:") {
+        answer = "loadtest";
+        step = STEP_PASSWORD;
+    }
+    else if (prompt == "Enter Your Aadhar Number:") {
+        answer = user.aadhar;
+        step = STEP_LOGIN_AADHAR;
+    }
+    else if (prompt == "Enter Your Password:") {
+        answer = "loadtest";
+        step = STEP_LOGIN;
+    }
+    else if (prompt.find("DASHBOARD") != string::npos) {
+        answer = user.wantsSeats(options) ? "2" : "3"; // reserve, or log out
+        step = STEP_DASHBOARD;
+    }
+    else if (prompt.find("Enter Trip ID") != string::npos) {
+        vector<string> listed = parseTripList(user.context);
+        if (!listed.empty())
+            user.trips = listed;
+        if (!user.wantsSeats(options) || user.trips.empty()) {
+            if (user.trips.empty())
+                user.tripTries = MAX_TRIP_TRIES;
+            answer = "e";
+        }
+        else {
+            answer = user.trips[rng() % user.trips.size()];
+            user.tripTries++;
+        }
+        step = STEP_TRIP;
+    }
+    else if (prompt.find("Choose seats") != string::npos) {
+        vector<int> free = parseFreeSeats(user.context);
+        if (!user.wantsSeats(options))
+            answer = "e";
+        else if (free.empty())
+            answer = "c";                              // full, try another trip
+        else
+            answer = to_string(free[rng() % free.size()]);
+        step = STEP_SEAT;
+    }
+    else if (prompt == "Passenger Name:") {
+        answer = user.name;
+        step = STEP_PASSENGER;
+    }
+    else if (prompt == "Aadhar Number:") {
+        answer = user.aadhar;
+        step = STEP_PASSENGER_AADHAR;
+    }
+    else if (prompt.find("Confirm (y/n)") != string::npos) {
+        answer = "y";
+        step = STEP_CONFIRM;
+    }
+    else if (prompt.find("Book another seat?") != string::npos) {
+        answer = user.wantsSeats(options) ? "y" : "n";
+        step = STEP_ANOTHER;
+    }
+    else
+        return false;
+
+    if (step == STEP_DASHBOARD && answer == "3" && user.booked < options.bookings)
+        stats.soldOut++;
+    user.context.clear();
+    return true;
+}
+
+void finishUser(LoadUser &user, LoadStats &stats, bool failed)
+{
+    if (user.done)
+        return;
+    user.done = true;
+    close(user.fd);
+    if (failed)
+        stats.failed++;
+    else
+        stats.sessions++;
+}
+
+// Read what the server sent and decide the answers to any prompts in it
+void pumpUser(LoadUser &user, const LoadOptions &options, LoadStats &stats, mt19937 &rng)
+{
+    char buffer[16384];
+    ssize_t n = recv(user.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR))
+        return;
+    if (n <= 0) {
+        // The server hangs up after we pick Exit; anywhere else is a failure
+        finishUser(user, stats, !user.menuSeen || user.answer != "3");
+        return;
+    }
+    user.pending.append(buffer, n);
+
+    if (!user.synced) {
+        size_t sync = user.pending.find(FRAME_SYNC);
+        if (sync == string::npos) {
+            user.pending.clear();
+            return;
+        }
+        user.pending.erase(0, sync + 1);
+        user.synced = true;
+    }
+
+    size_t pos = 0;
+    char type;
+    string payload;
+    FrameStatus status;
+    while ((status = decodeFrame(user.pending, pos, MAX_FRAME, type, payload)) == FRAME_READY) {
+        if (type == FRAME_MESSAGE)
+            user.context += payload;
+        if (type != FRAME_PROMPT)
+            continue;   // notices about other passengers' bookings need no reply
+
+        LoadClock::time_point now = LoadClock::now();
+        if (user.waiting) {
+            stats.steps[user.step].record(chrono::duration_cast<chrono::microseconds>(now - user.sentAt).count());
+            user.waiting = false;
+        }
+
+        LoadStep step;
+        if (!decideAnswer(user, payload, options, stats, rng, user.answer, step)) {
+            cerr << "⚠️  Unexpected prompt: " << payload << "\n";
+            sendAll(user.fd, encodeFrame(FRAME_BYE, ""));
+            finishUser(user, stats, true);
+            return;
+        }
+        user.step = step;
+        int think = options.thinkMs > 0 ? options.thinkMs / 2 + int(rng() % (options.thinkMs + 1)) : 0;
+        user.answerAt = now + chrono::milliseconds(think);
+        user.answerDue = true;
+    }
+    user.pending.erase(0, pos);
+
+    if (status == FRAME_TOO_LARGE)
+        finishUser(user, stats, true);
+}
+
+int connectTo(const LoadOptions &options)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == -1)
+        return -1;
+    struct sockaddr_in server;
+    server.sin_family = AF_INET;
+    server.sin_port = htons(options.port);
+    server.sin_addr.s_addr = inet_addr(options.host.c_str());
+    if (connect(fd, (struct sockaddr*)&server, sizeof(server)) < 0 ||
+        !sendAll(fd, string(1, FRAME_SYNC) + encodeFrame(FRAME_HELLO, PROTOCOL_VERSION))) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void printLoadReport(const LoadOptions &options, const LoadStats &stats, double seconds)
+{
+    printf("\n✅ %llu/%d sessions completed in %.2f s (%.1f sessions/s)\n",
+           (unsigned long long)stats.sessions, options.users, seconds, stats.sessions / seconds);
+    printf("   bookings: %llu (%.1f/s), lost races %llu, gave up %llu, failed sessions %llu\n",
+           (unsigned long long)stats.booked, stats.booked / seconds, (unsigned long long)stats.conflicts,
+           (unsigned long long)stats.soldOut, (unsigned long long)stats.failed);
+    printf("   answers:  %llu (%.1f/s)\n\n", (unsigned long long)stats.answers, stats.answers / seconds);
+
+    printf("%-18s %8s %10s %10s %10s %10s   (ms)\n", "step", "count", "p50", "p99", "p999", "max");
+    for (int i = 0; i < STEP_COUNT; ++i) {
+        const LatencyHistogram &h = stats.steps[i];
+        if (h.count() == 0)
+            continue;
+        printf("%-18s %8llu %10.2f %10.2f %10.2f %10.2f\n", LOAD_STEP_NAMES[i], (unsigned long long)h.count(),
+               h.percentile(50) / 1000.0, h.percentile(99) / 1000.0, h.percentile(99.9) / 1000.0, h.max() / 1000.0);
+    }
+}
+
+int runLoad(const LoadOptions &options)
+{
+    // Every passenger needs a descriptor
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    mt19937 rng(options.seed ? options.seed : random_device{}());
+    // Fresh 12-digit Aadhar numbers per run, so passengers register for real
+    uint64_t firstAadhar = 800000000000ULL + (rng() % 10000) * 10000000ULL;
+
+    LoadStats stats;
+    vector<LoadUser> users(options.users);
+    LoadClock::time_point start = LoadClock::now();
+    for (int i = 0; i < options.users; ++i) {
+        LoadUser &user = users[i];
+        user.aadhar = to_string(firstAadhar + i);
+        user.name = "Load " + user.aadhar;
+        user.fd = connectTo(options);
+        if (user.fd == -1) {
+            user.done = true;
+            stats.failed++;
+        }
+    }
+    printf("🚀 %d passengers on %s:%d, think %d ms, %d booking(s) each\n",
+           options.users, options.host.c_str(), options.port, options.thinkMs, options.bookings);
+
+    vector<pollfd> fds;
+    vector<LoadUser *> polled;
+    while (true) {
+        // Send answers whose think time is over, and find the next one due
+        LoadClock::time_point now = LoadClock::now();
+        int timeout = -1;
+        fds.clear();
+        polled.clear();
+        for (LoadUser &user : users) {
+            if (user.done)
+                continue;
+            if (user.answerDue && user.answerAt <= now) {
+                user.answerDue = false;
+                user.sentAt = LoadClock::now();
+                user.waiting = true;
+                stats.answers++;
+                if (!sendAll(user.fd, encodeFrame(FRAME_INPUT, user.answer))) {
+                    finishUser(user, stats, true);
+                    continue;
+                }
+            }
+            else if (user.answerDue) {
+                int wait = chrono::duration_cast<chrono::milliseconds>(user.answerAt - now).count() + 1;
+                if (timeout < 0 || wait < timeout)
+                    timeout = wait;
+            }
+            fds.push_back({user.fd, POLLIN, 0});
+            polled.push_back(&user);
+        }
+        if (fds.empty())
+            break;
+
+        if (poll(fds.data(), fds.size(), timeout) < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        for (size_t i = 0; i < fds.size(); ++i)
+            if (fds[i].revents)
+                pumpUser(*polled[i], options, stats, rng);
+    }
+
+    double seconds = chrono::duration<double>(LoadClock::now() - start).count();
+    printLoadReport(options, stats, seconds);
+    return stats.failed ? 1 : 0;
+}
+
+// Options after --load; false on anything we don't understand
+bool parseLoadOptions(int argc, char *argv[], LoadOptions &options)
+{
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (i + 1 >= argc)
+            return false;
+        string value = argv[++i];
+        if (arg == "--load")
+            options.users = atoi(value.c_str());
+        else if (arg == "--think")
+            options.thinkMs = atoi(value.c_str());
+        else if (arg == "--bookings")
+            options.bookings = atoi(value.c_str());
+        else if (arg == "--host")
+            options.host = value;
+        else if (arg == "--port")
+            options.port = atoi(value.c_str());
+        else if (arg == "--seed")
+            options.seed = strtoul(value.c_str(), nullptr, 10);
+        else
+            return false;
+    }
+    return options.users > 0 && options.thinkMs >= 0 && options.bookings >= 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1) {
+        LoadOptions options;
+        if (!parseLoadOptions(argc, argv, options)) {
+            cerr << "Usage: " << argv[0] << " [--load N [--think MS] [--bookings K] [--host IP] [--port P] [--seed S]]\n";
+            return 1;
+        }
+        return runLoad(options);
+    }
+
     sock = socket(AF_INET, SOCK_STREAM, 0);
     if (sock == -1) {
         cerr << "❌ Socket creation failed\n";
@@ -41,62 +596,90 @@ int main() {
 
     cout << "✅ Connected to the server!\n";
 
-    char buffer[8192];
-
-while (true) {
-    memset(buffer, 0, sizeof(buffer));
-
-    // Receive message from server
-    int bytesReceived = recv(sock, buffer, sizeof(buffer) - 1, 0);
-    if (bytesReceived <= 0) {
-        cout << "🔌 Server disconnected.\n";
-        break;
+    // Switch this connection to framed messages (see protocol.h)
+    if (!sendAll(string(1, FRAME_SYNC) + encodeFrame(FRAME_HELLO, PROTOCOL_VERSION))) {
+        cerr << "❌ Failed to greet the server\n";
+        return 1;
     }
 
-    buffer[bytesReceived] = '\0';
-    string message(buffer);
+    char buffer[8192];
+    string pending, typed;
+    bool synced = false;
+    bool answering = false;   // a PROMPT is waiting for our INPUT
+    bool stdinOpen = true;
 
-    // ✅ Always print the server message
-    cout << message;
+    // Watch the server and the keyboard together, so notices pushed by the
+    // server show up even while we are waiting for the user to type
+    while (true) {
+        pollfd fds[2] = {{sock, POLLIN, 0}, {STDIN_FILENO, POLLIN, 0}};
+        if (poll(fds, stdinOpen ? 2 : 1, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
 
-    // ✅ Check for the explicit prompt marker
-   if (message.rfind("PROMPT@") != string::npos &&
-    message.length() >= 7 &&
-    message.substr(message.length() - 7) == "PROMPT@") {
+        if (stdinOpen && fds[1].revents) {
+            int n = read(STDIN_FILENO, buffer, sizeof(buffer));
+            if (n > 0)
+                typed.append(buffer, n);
+            else
+                stdinOpen = false;   // still answer with whatever was typed ahead
+        }
 
-    string input;
-    int blankCount = 0;
+        if (fds[0].revents) {
+            // Receive message from server
+            int bytesReceived = recv(sock, buffer, sizeof(buffer), 0);
+            if (bytesReceived <= 0) {
+                cout << "🔌 Server disconnected.\n";
+                break;
+            }
+            pending.append(buffer, bytesReceived);
 
-    while (true) {
-        cout << "> ";
-        getline(cin, input);
+            // Skip the text greeting meant for old clients, up to the server's sync byte
+            if (!synced) {
+                size_t sync = pending.find(FRAME_SYNC);
+                if (sync == string::npos) {
+                    pending.clear();
+                    continue;
+                }
+                pending.erase(0, sync + 1);
+                synced = true;
+            }
 
-        // Trim the input
-        size_t start = input.find_first_not_of(" \t\r\n");
-        if (start == string::npos) {
-            blankCount++;
-            if (blankCount == 1) {
-                cout << "⚠️  Empty input. Please enter again:\n";
-                continue; // prompt again
-            } else {
-                // Send a space to keep sync and inform server it's junk
-                input = " ";
+            size_t pos = 0;
+            char type;
+            string payload;
+            FrameStatus status;
+            while ((status = decodeFrame(pending, pos, MAX_FRAME, type, payload)) == FRAME_READY) {
+                // ✅ Always print the server message
+                cout << payload;
+                if (type == FRAME_PROMPT)
+                    answering = true;
+                // A notice interrupts the open question, so show the input marker again
+                if (type == FRAME_PROMPT || (type == FRAME_NOTICE && answering))
+                    cout << "> ";
+                cout << flush;
+            }
+            pending.erase(0, pos);
+
+            if (status == FRAME_TOO_LARGE) {
+                cerr << "❌ Malformed message from the server\n";
                 break;
             }
-        } else {
-            break; // valid input
         }
-    }
 
-    input += '\n';
-
-    if (send(sock, input.c_str(), input.length(), 0) == -1) {
-        cerr << "❌ Failed to send input\n";
-        break;
+        // Lines typed ahead are kept until the server asks for them
+        string input;
+        if (answering && takeAnswer(typed, input)) {
+            answering = false;
+            if (!sendAll(encodeFrame(FRAME_INPUT, input)))
+                break;
         }
-     }
-}
+        else if (answering && !stdinOpen) {
+            sendAll(encodeFrame(FRAME_BYE, ""));
+            break;
+        }
+    }
     close(sock);
     return 0;
 }
-
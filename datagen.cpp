@@ -0,0 +1,457 @@
+// Synthetic data sets for scale testing.
+//
+// Build: g++ -std=c++20 -O2 datagen.cpp -o datagen -lcrypto -pthread
+// Run:   ./datagen [--out DIR] [--buses N] [--drivers N] [--trips N] [--users N]
+//                  [--bookings N] [--occupancy R] [--from DAYS] [--days DAYS]
+//                  [--departures uniform|peak] [--password P] [--legacy-seats] [--seed S]
+//
+// Writes buses.txt, drivers.txt, users.txt, trips.txt, bookings.txt and
+// seats.bin into DIR (default ./dataset), in exactly the formats the server
+// reads, so the directory can be used as the server's working directory.
+// The server is compiled in for its record layouts, prices and password
+// hashing, so the files cannot drift from what it expects.
+//
+// Everything is consistent: every bus belongs to a driver, a bus never has
+// two trips within an hour of each other, every booked seat has exactly one
+// row in bookings.txt with a registered passenger's Aadhar and name, and
+// seats.bin marks exactly those seats. Trips depart between --from and
+// --from + --days days from now, either spread evenly or bunched around the
+// morning and evening rush (--departures peak). Each seat of a trip is booked
+// with probability --occupancy, trip after trip, until --bookings rows have
+// been written; with no --bookings every trip is filled that way.
+//
+// Rows are formatted straight into a large buffer and written out as they
+// are made, and only a few bytes per trip are kept in memory, so 50 million
+// bookings take as long as writing a few GB to disk. Every user and driver
+// gets the same password (--password, default "password"), hashed once.
+// --legacy-seats writes one seat<TripId>.txt per trip instead of seats.bin,
+// for testing the server's one-off import.
+#define BUS_SERVER_NO_MAIN
+#include "newserver.cpp"
+
+#include <chrono>
+#include <filesystem>
+
+// Append-only output file; rows are formatted into a buffer that goes to the
+// file whenever it fills up
+class RowWriter
+{
+    static const size_t BUFFER_SIZE = 1 << 22;
+    static const size_t MAX_PUT = 4096;     // longer puts bypass the buffer
+
+    FILE *file = nullptr;
+    unique_ptr<char[]> buffer;
+    size_t used = 0;
+
+    void spill();
+
+public:
+    bool open(const string &path);
+    bool close();
+
+    RowWriter &put(string_view text);
+    RowWriter &put(char c);
+    RowWriter &put(uint64_t n);
+    RowWriter &put(const void *data, size_t n);
+};
+
+bool RowWriter::open(const string &path)
+{
+    file = fopen(path.c_str(), "wb");
+    if (!file)
+    {
+        perror(("[DATAGEN] " + path).c_str());
+        return false;
+    }
+    buffer = make_unique<char[]>(BUFFER_SIZE + MAX_PUT);
+    used = 0;
+    return true;
+}
+
+void RowWriter::spill()
+{
+    fwrite(buffer.get(), 1, used, file);
+    used = 0;
+}
+
+bool RowWriter::close()
+{
+    spill();
+    bool ok = !ferror(file);
+    ok = fclose(file) == 0 && ok;
+    file = nullptr;
+    return ok;
+}
+
+// The buffer has MAX_PUT bytes of slack past BUFFER_SIZE, so a put only
+// checks for a spill after copying
+RowWriter &RowWriter::put(string_view text)
+{
+    if (text.size() > MAX_PUT)
+    {
+        spill();
+        fwrite(text.data(), 1, text.size(), file);
+        return *this;
+    }
+    memcpy(buffer.get() + used, text.data(), text.size());
+    used += text.size();
+    if (used >= BUFFER_SIZE)
+        spill();
+    return *this;
+}
+
+RowWriter &RowWriter::put(char c)
+{
+    return put(string_view(&c, 1));
+}
+
+RowWriter &RowWriter::put(uint64_t n)
+{
+    char digits[24];
+    auto r = to_chars(digits, digits + sizeof(digits), n);
+    return put(string_view(digits, r.ptr - digits));
+}
+
+RowWriter &RowWriter::put(const void *data, size_t n)
+{
+    return put(string_view(static_cast<const char *>(data), n));
+}
+
+// splitmix64: plenty random for test data, and a few ns a number
+struct FastRandom
+{
+    uint64_t state;
+
+    explicit FastRandom(uint64_t seed) : state(seed) {}
+    uint64_t next()
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+    uint64_t below(uint64_t n) { return next() % n; }
+    double unit() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+};
+
+struct DatagenOptions
+{
+    string out = "dataset";
+    uint64_t buses = 1000, drivers = 500, trips = 100000, users = 100000;
+    int64_t bookings = -1;          // -1: fill every trip to the occupancy
+    double occupancy = 0.6;
+    double fromDays = 0, days = 30;
+    bool peak = false;
+    string password = "password";
+    bool legacySeats = false;
+    uint64_t seed = 1;
+};
+
+// Bus layouts to pick from; all within MAX_SEATS
+const pair<int, int> BUS_LAYOUTS[] = {{10, 4}, {9, 4}, {12, 4}, {8, 5}, {10, 5}};
+
+const char *const CITIES[] = {
+    "Howrah", "Durgapur", "Pelling", "Jaisalmer", "Srinagar", "Siliguri", "Digha", "Puri",
+    "Ranchi", "Patna", "Gangtok", "Darjeeling", "Asansol", "Kharagpur", "Bhubaneswar", "Guwahati",
+};
+const size_t CITY_COUNT = sizeof(CITIES) / sizeof(CITIES[0]);
+
+// First Aadhar numbers handed out; users and drivers never overlap
+const uint64_t FIRST_USER_AADHAR = 100000000000ULL;
+const uint64_t FIRST_DRIVER_AADHAR = 900000000000ULL;
+const uint64_t FIRST_LICENSE = 1000000000000000ULL;
+
+// Trips of one bus leave at least this far apart (the server wants 60 minutes)
+const time_t MIN_TRIP_GAP = 61 * 60;
+
+// What later passes need to know about a trip
+struct GeneratedTrip
+{
+    uint32_t bus;
+    uint16_t distance;
+};
+
+// Timestamps in the format the server writes with ctime() and "%c".
+// localtime_r, unlike localtime, does not look the time zone up again on
+// every call; main() calls tzset() once instead.
+string formatTime(time_t t)
+{
+    tm local;
+    localtime_r(&t, &local);
+    char text[64];
+    strftime(text, sizeof(text), "%a %b %e %H:%M:%S %Y", &local);
+    return text;
+}
+
+string tripIdFor(uint64_t index)
+{
+    char id[24];
+    snprintf(id, sizeof(id), "T%03llu", (unsigned long long)index + 1);
+    return id;
+}
+
+// Seconds from the start of the window for one departure
+time_t sampleDeparture(const DatagenOptions &options, FastRandom &rng)
+{
+    time_t window = time_t(options.days * 86400);
+    if (!options.peak)
+        return rng.below(max<time_t>(window, 1));
+
+    // Most buses leave around 8:00 and 18:00, the rest any time of day
+    time_t day = rng.below(max<time_t>(window / 86400, 1)) * 86400;
+    double hour;
+    double pick = rng.unit();
+    if (pick < 0.8)
+    {
+        // Box-Muller: normal with a 1.5 hour spread around the rush hour
+        double u1 = max(rng.unit(), 1e-12), u2 = rng.unit();
+        double normal = sqrt(-2 * log(u1)) * cos(2 * M_PI * u2);
+        hour = (pick < 0.4 ? 8 : 18) + 1.5 * normal;
+        hour = min(max(hour, 0.0), 23.99);
+    }
+    else
+        hour = rng.unit() * 24;
+    return day + time_t(hour * 3600);
+}
+
+bool writePeople(const DatagenOptions &options, const string &hash)
+{
+    RowWriter users, drivers;
+    if (!users.open(options.out + "/" + USER_FILE) || !drivers.open(options.out + "/" + DRIVER_FILE))
+        return false;
+
+    for (uint64_t i = 0; i < options.users; ++i)
+        users.put(FIRST_USER_AADHAR + i).put(",User ").put(i).put(',')
+            .put(uint64_t(18 + i % 60)).put(',').put(hash).put('\n');
+
+    for (uint64_t i = 0; i < options.drivers; ++i)
+        drivers.put(FIRST_DRIVER_AADHAR + i).put(',').put(FIRST_LICENSE + i).put(",Driver ").put(i).put(',')
+            .put(uint64_t(25 + i % 35)).put(',').put(hash).put('\n');
+
+    return users.close() && drivers.close();
+}
+
+bool writeBuses(const DatagenOptions &options, vector<pair<int, int>> &layouts, FastRandom &rng)
+{
+    RowWriter buses;
+    if (!buses.open(options.out + "/" + BUS_FILE))
+        return false;
+
+    for (uint64_t b = 0; b < options.buses; ++b)
+    {
+        auto layout = BUS_LAYOUTS[rng.below(size(BUS_LAYOUTS))];
+        layouts.push_back(layout);
+        buses.put(uint64_t(1000 + b)).put(',').put(FIRST_DRIVER_AADHAR + b % options.drivers).put(',')
+            .put(uint64_t(layout.first)).put(',').put(uint64_t(layout.second)).put('\n');
+    }
+    return buses.close();
+}
+
+// Trips go out bus by bus: each bus gets its share of departures, sorted and
+// pushed apart so no two of its trips clash
+bool writeTrips(const DatagenOptions &options, vector<GeneratedTrip> &trips, FastRandom &rng)
+{
+    RowWriter out;
+    if (!out.open(options.out + "/" + TRIPS_FILE))
+        return false;
+
+    time_t start = (time(nullptr) + time_t(options.fromDays * 86400)) / 60 * 60;
+    trips.reserve(options.trips);
+    vector<time_t> departures;
+    for (uint64_t b = 0; b < options.buses; ++b)
+    {
+        uint64_t share = options.trips / options.buses + (b < options.trips % options.buses ? 1 : 0);
+        departures.clear();
+        for (uint64_t i = 0; i < share; ++i)
+            departures.push_back(sampleDeparture(options, rng) / 60 * 60);
+        sort(departures.begin(), departures.end());
+        for (size_t i = 1; i < departures.size(); ++i)
+            departures[i] = max(departures[i], departures[i - 1] + MIN_TRIP_GAP);
+
+        for (time_t departure : departures)
+        {
+            size_t from = rng.below(CITY_COUNT), to = (from + 1 + rng.below(CITY_COUNT - 1)) % CITY_COUNT;
+            GeneratedTrip trip{uint32_t(b), uint16_t(50 + rng.below(750))};
+            out.put(tripIdFor(trips.size())).put(',').put(uint64_t(1000 + b)).put(',')
+                .put(CITIES[from]).put(',').put(CITIES[to]).put(',').put(uint64_t(trip.distance)).put(',')
+                .put(FIRST_DRIVER_AADHAR + b % options.drivers).put(',').put(formatTime(start + departure)).put('\n');
+            trips.push_back(trip);
+        }
+    }
+    return out.close();
+}
+
+// Seats and bookings, trip by trip: each seat is booked with probability
+// occupancy until the booking budget runs out, and the same bits go to the
+// trip's seat record
+bool writeSeatsAndBookings(const DatagenOptions &options, const vector<GeneratedTrip> &trips,
+                           const vector<pair<int, int>> &layouts, FastRandom &rng, uint64_t &booked)
+{
+    RowWriter bookings, seats;
+    if (!bookings.open(options.out + "/" + BOOKING_FILE))
+        return false;
+    if (!options.legacySeats)
+    {
+        if (!seats.open(options.out + "/" + SEAT_FILE))
+            return false;
+        SeatFileHeader header;
+        memset(&header, 0, sizeof(header));
+        strcpy(header.magic, "BRSEAT1");
+        header.recordSize = sizeof(SeatRecord);
+        header.count = trips.size();
+        seats.put(&header, sizeof(header));
+    }
+
+    // Booking times are drawn from a pool over the last 30 days, formatted once
+    vector<string> bookedAt;
+    time_t now = time(nullptr);
+    for (int i = 0; i < 4096; ++i)
+        bookedAt.push_back(formatTime(now - time_t(rng.below(30 * 86400))));
+
+    uint64_t budget = options.bookings < 0 ? UINT64_MAX : uint64_t(options.bookings);
+    booked = 0;
+    for (size_t t = 0; t < trips.size(); ++t)
+    {
+        auto [rows, cols] = layouts[trips[t].bus];
+        string tripId = tripIdFor(t);
+        string busNo = to_string(1000 + trips[t].bus);
+        SeatLayout layout = seatLayoutFor(tripId, rows, cols, trips[t].distance);
+        string prices[4];
+        for (int c = 0; c < 4; ++c)
+            prices[c] = to_string(float(layout.classPrice[c]));
+
+        for (int seatNo = 1; seatNo <= rows * cols && booked < budget; ++seatNo)
+        {
+            if (rng.unit() >= options.occupancy)
+                continue;
+            layout.booked[(seatNo - 1) / 64] |= 1ULL << ((seatNo - 1) % 64);
+            uint64_t user = rng.below(options.users);
+            bookings.put(tripId).put(',').put(busNo).put(',').put(uint64_t(seatNo)).put(',')
+                .put(FIRST_USER_AADHAR + user).put(",User ").put(user).put(',')
+                .put(prices[seatClassOf(seatNo - 1, rows, cols)]).put(',')
+                .put(bookedAt[rng.below(bookedAt.size())]).put('\n');
+            booked++;
+        }
+
+        if (options.legacySeats)
+        {
+            // seat<TripId>.txt: seatNo,booked,price per seat
+            RowWriter legacy;
+            if (!legacy.open(options.out + "/seat" + tripId + ".txt"))
+                return false;
+            for (int seatNo = 1; seatNo <= rows * cols; ++seatNo)
+            {
+                bool taken = (layout.booked[(seatNo - 1) / 64] >> ((seatNo - 1) % 64)) & 1;
+                legacy.put(uint64_t(seatNo)).put(taken ? ",1," : ",0,")
+                    .put(uint64_t(layout.classPrice[seatClassOf(seatNo - 1, rows, cols)])).put('\n');
+            }
+            if (!legacy.close())
+                return false;
+            continue;
+        }
+
+        SeatRecord rec;
+        memset(&rec, 0, sizeof(rec));
+        strncpy(rec.tripId, tripId.c_str(), sizeof(rec.tripId) - 1);
+        rec.rows = rows;
+        rec.cols = cols;
+        memcpy(rec.classPrice, layout.classPrice, sizeof(rec.classPrice));
+        memcpy(rec.booked, layout.booked, sizeof(rec.booked));
+        seats.put(&rec, sizeof(rec));
+    }
+
+    if (!options.legacySeats && !seats.close())
+        return false;
+    return bookings.close();
+}
+
+// Options as --name value pairs; false on anything we don't understand
+bool parseDatagenOptions(int argc, char *argv[], DatagenOptions &options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "--legacy-seats")
+        {
+            options.legacySeats = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+            return false;
+        string value = argv[++i];
+        if (arg == "--out")
+            options.out = value;
+        else if (arg == "--buses")
+            options.buses = strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--drivers")
+            options.drivers = strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--trips")
+            options.trips = strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--users")
+            options.users = strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--bookings")
+            options.bookings = strtoll(value.c_str(), nullptr, 10);
+        else if (arg == "--occupancy")
+            options.occupancy = atof(value.c_str());
+        else if (arg == "--from")
+            options.fromDays = atof(value.c_str());
+        else if (arg == "--days")
+            options.days = atof(value.c_str());
+        else if (arg == "--departures" && (value == "uniform" || value == "peak"))
+            options.peak = value == "peak";
+        else if (arg == "--password")
+            options.password = value;
+        else if (arg == "--seed")
+            options.seed = strtoull(value.c_str(), nullptr, 10);
+        else
+            return false;
+    }
+    return options.buses > 0 && options.drivers > 0 && options.users > 0 && options.days > 0 &&
+           options.occupancy >= 0 && options.occupancy <= 1 &&
+           options.users < FIRST_DRIVER_AADHAR - FIRST_USER_AADHAR &&
+           options.drivers < 100000000000ULL && options.trips < MAX_TRIP_RECORDS;
+}
+
+int main(int argc, char *argv[])
+{
+    DatagenOptions options;
+    if (!parseDatagenOptions(argc, argv, options))
+    {
+        cerr << "Usage: " << argv[0] << " [--out DIR] [--buses N] [--drivers N] [--trips N] [--users N]\n"
+             << "       [--bookings N] [--occupancy 0..1] [--from DAYS] [--days DAYS]\n"
+             << "       [--departures uniform|peak] [--password P] [--legacy-seats] [--seed S]\n";
+        return 1;
+    }
+    error_code ec;
+    filesystem::create_directories(options.out, ec);
+    if (ec)
+    {
+        cerr << "❌ " << options.out << ": " << ec.message() << "\n";
+        return 1;
+    }
+
+    tzset();
+    auto t0 = chrono::steady_clock::now();
+    FastRandom rng(options.seed);
+    char hash[SHA256_DIGEST_LENGTH * 2 + 1];
+    hash_password(options.password.c_str(), hash);
+
+    vector<pair<int, int>> layouts;
+    vector<GeneratedTrip> trips;
+    uint64_t booked = 0;
+    if (!writePeople(options, hash) || !writeBuses(options, layouts, rng) || !writeTrips(options, trips, rng) ||
+        !writeSeatsAndBookings(options, trips, layouts, rng, booked))
+    {
+        cerr << "❌ Could not write the data set to " << options.out << "\n";
+        return 1;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+    if (options.bookings >= 0 && booked < uint64_t(options.bookings))
+        cerr << "⚠️  Only " << booked << " bookings fit in " << trips.size() << " trips at occupancy "
+             << options.occupancy << "; add trips or raise --occupancy\n";
+    cout << "✅ " << options.users << " users, " << options.drivers << " drivers, " << options.buses << " buses, "
+         << trips.size() << " trips and " << booked << " bookings written to " << options.out
+         << " in " << fixed << setprecision(2) << seconds << " s\n";
+    return 0;
+}
@@ -0,0 +1,111 @@
+// Startup test: legacy seat files keep their bookings.
+//
+// Build: g++ -std=c++20 legacytest.cpp -o legacytest -lcrypto -pthread
+// Run:   ./legacytest [DATA_DIR]      (default: the current directory)
+//
+// Copies the data files of DATA_DIR (trips, buses, bookings, accounts and the
+// seat<TripId>.txt files written before seats.bin existed) into a scratch
+// directory under /tmp and starts the stores there twice: once importing the
+// legacy files, once from the seats.bin that import wrote. After each start,
+// every seat that is booked in its legacy file or has a row in bookings.txt
+// must be booked, and no other seat may be. Exits non-zero on any mismatch.
+#define BUS_SERVER_NO_MAIN
+#include "newserver.cpp"
+
+#include <filesystem>
+#include <sys/wait.h>
+
+namespace fs = std::filesystem;
+
+using SeatSet = set<int>;
+
+// TripID -> seats a legacy file or a booking row says are sold
+map<string, SeatSet> expectedSeats(const fs::path &dir)
+{
+    map<string, SeatSet> expected;
+    for (auto &entry : fs::directory_iterator(dir))
+    {
+        string file = entry.path().filename();
+        if (file.rfind("seat", 0) != 0 || entry.path().extension() != ".txt")
+            continue;
+        string tripId = file.substr(4, file.size() - 8);
+        CsvFile seatData;
+        seatData.load(entry.path());
+        expected[tripId];
+        for (auto row : seatData)
+            if (row.size() >= 2 && row[1] == "1")
+                expected[tripId].insert(stoi(string(row[0])));
+    }
+    CsvFile bookings;
+    bookings.load(dir / BOOKING_FILE);
+    for (auto row : bookings)
+        if (row.size() >= 3 && expected.count(string(row[0])))
+            expected[string(row[0])].insert(stoi(string(row[2])));
+    return expected;
+}
+
+// One server start in its own process, so every store starts out empty
+bool startAndCheck(const fs::path &dir, const map<string, SeatSet> &expected, const char *label)
+{
+    cout.flush();
+    pid_t child = fork();
+    if (child == 0)
+    {
+        fs::current_path(dir);
+        int failures = 0;
+        if (!loadStores())
+            failures++;
+        for (auto &[tripId, seats] : expected)
+        {
+            SeatSnapshot snap;
+            if (!seatStore.snapshot(tripId, snap))
+            {
+                cerr << "❌ " << label << ": " << tripId << " is not in " << SEAT_FILE << "\n";
+                failures++;
+                continue;
+            }
+            for (int seatNo = 1; seatNo <= snap.seatCount(); ++seatNo)
+                if (snap.isBooked(seatNo) != (seats.count(seatNo) > 0))
+                {
+                    cerr << "❌ " << label << ": " << tripId << " seat " << seatNo << " is "
+                         << (snap.isBooked(seatNo) ? "booked" : "free") << "\n";
+                    failures++;
+                }
+        }
+        logger.stop();
+        cout.flush();
+        _exit(failures ? 1 : 0);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    cout << (ok ? "✅ " : "❌ ") << label << "\n";
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    fs::path source = fs::absolute(argc > 1 ? argv[1] : ".");
+    char scratchName[] = "/tmp/bus-legacytest-XXXXXX";
+    if (!mkdtemp(scratchName))
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+    fs::path scratch = scratchName;
+
+    for (auto &entry : fs::directory_iterator(source))
+        if (entry.path().extension() == ".txt")
+            fs::copy_file(entry.path(), scratch / entry.path().filename());
+
+    map<string, SeatSet> expected = expectedSeats(scratch);
+    size_t sold = 0;
+    for (auto &[tripId, seats] : expected)
+        sold += seats.size();
+    cout << "💺 " << expected.size() << " legacy seat files, " << sold << " seats sold\n";
+
+    bool ok = startAndCheck(scratch, expected, "first start imports the legacy seats") &&
+              startAndCheck(scratch, expected, "restart keeps them");
+    fs::remove_all(scratch);
+    return ok ? 0 : 1;
+}
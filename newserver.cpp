@@ -1,1597 +1,5661 @@
+// The session dialogues are C++20 coroutines
+#if __cplusplus < 202002L
+#error "compile newserver.cpp with -std=c++20"
+#endif
+
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <charconv>
 #include <vector>
+#include <array>
 #include <mutex>
 #include <thread>
+#include <chrono>
+#include <future>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <deque>
+#include <optional>
+#include <coroutine>
+#include <utility>
 #include <netinet/in.h>
 #include <unistd.h>
 #include <cstring>
+#include <cstdio>
 #include <cstdlib>
 #include <algorithm>
 #include <iomanip>
 #include <arpa/inet.h>
 #include <ctime>
 #include <math.h>
+#include <map>
+#include <set>
 #include <unordered_map>
-#include <fcntl.h> 
-#include <sys/select.h>
+#include <unordered_set>
+#include <shared_mutex>
+#include <source_location>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/time.h>
 #include <netinet/tcp.h>
-#include <regex>
 #include <openssl/sha.h>
 
+#include "protocol.h"
+
 #define BROADCAST_PORT 9000
 #define TCP_PORT 8050
+#define API_PORT 8051
+#define ADMIN_PORT 8052
 
 using namespace std;
 
-mutex mtx;
-
 const string USER_FILE = "users.txt";
 const string DRIVER_FILE = "drivers.txt";
 const string TRIPS_FILE = "trips.txt";
 const string BOOKING_FILE = "bookings.txt";
 const string BUS_FILE = "buses.txt";
 
-// --- UTILITY ---
-
-// Read from a file
-vector<vector<string>> readFile(const string &filename)
-{
-    vector<vector<string>> data;
-    ifstream file(filename);
-    string line;
-    while (getline(file, line))
-    {
-        stringstream ss(line);
-        vector<string> row;
-        string cell;
-        while (getline(ss, cell, ','))
-            row.push_back(cell);
-        data.push_back(row);
-    }
-    return data;
-}
+// --- LOGGING ---
 
+// Log lines never touch cout on the calling thread. Each thread appends to
+// its own single-producer ring (a few atomics, no locks, never blocks: a
+// full ring drops the line and counts it) and one background thread drains
+// every ring to stdout in timestamp order. Payload tracing is LOG_TRACE,
+// which is off unless the server is started with --trace.
+enum LogLevel { LOG_TRACE, LOG_INFO, LOG_WARN, LOG_ERROR };
 
-void hash_password(const char *password, char *output)
+class Logger
 {
-    unsigned char hash[SHA256_DIGEST_LENGTH];
-    SHA256((const unsigned char *)password, strlen(password), hash);
-    for (int i = 0; i < SHA256_DIGEST_LENGTH; i++)
-        sprintf(output + (i * 2), "%02x", hash[i]);
-    output[SHA256_DIGEST_LENGTH * 2] = '\0';
-}
-string extractTime(const string &dateTime) {
-    // Example: "Thu May 15 06:45:00 2025" --> "06:45"
-    size_t timeStart = dateTime.find(':') - 2;
-    return dateTime.substr(timeStart, 5); // extracts "06:45"
-}
-string extractDateDDMMYYYY(const string &dateTime) {
-    // input: "Thu May 15 06:45:00 2025"
-    // output: "15/05/2025"
-    istringstream iss(dateTime);
-    string dayOfWeek, monthStr, dayStr, timeStr, yearStr;
-    iss >> dayOfWeek >> monthStr >> dayStr >> timeStr >> yearStr;
+    static const size_t RING_SIZE = 1024;   // per thread, a power of two
 
-    // Convert month name to number
-    map<string, string> monthMap = {
-        {"Jan", "01"}, {"Feb", "02"}, {"Mar", "03"}, {"Apr", "04"},
-        {"May", "05"}, {"Jun", "06"}, {"Jul", "07"}, {"Aug", "08"},
-        {"Sep", "09"}, {"Oct", "10"}, {"Nov", "11"}, {"Dec", "12"}
+    struct Entry
+    {
+        LogLevel level;
+        timespec at;
+        string text;
     };
 
-    string month = monthMap[monthStr];
+    struct Ring
+    {
+        Entry slots[RING_SIZE];
+        atomic<size_t> head{0};      // next slot the owning thread fills
+        atomic<size_t> tail{0};      // next slot the drain thread empties
+        atomic<size_t> dropped{0};
+    };
 
-    if (dayStr.length() == 1) dayStr = "0" + dayStr;
+    atomic<int> minLevel{LOG_INFO};
+    mutex ringsLock;                 // only taken when a thread logs for the first time
+    vector<unique_ptr<Ring>> rings;
+    atomic<bool> stopping{false};
+    thread drainer;
 
-    return dayStr + "/" + month + "/" + yearStr;
-}
+    Ring &ownRing();
+    bool drain();
+    void run();
 
+public:
+    ~Logger() { stop(); }
 
+    void start();
+    void stop();                     // writes out whatever is still queued
+    void setLevel(LogLevel level) { minLevel = level; }
+    bool enabled(LogLevel level) const { return level >= minLevel.load(memory_order_relaxed); }
+    void log(LogLevel level, string text);
+};
 
-// Escape special characters in CSV
-string escapeCSV(const string &field)
+Logger::Ring &Logger::ownRing()
 {
-    string escaped = field;
-    bool needsQuotes = escaped.find(',') != string::npos ||
-                       escaped.find('"') != string::npos ||
-                       escaped.find('\n') != string::npos;
-
-    if (needsQuotes)
+    static thread_local Ring *ring = nullptr;
+    if (!ring)
     {
-        size_t pos = 0;
-        while ((pos = escaped.find('"', pos)) != string::npos)
-        {
-            escaped.insert(pos, "\""); // Escape quotes by doubling them
-            pos += 2;
-        }
-        escaped = "\"" + escaped + "\"";
+        lock_guard<mutex> guard(ringsLock);
+        rings.push_back(make_unique<Ring>());
+        ring = rings.back().get();
     }
-
-    return escaped;
+    return *ring;
 }
 
-// FOR FINDING UPCOMING TRIPS ++ DYNAMIC PRICING
-int timeToMinutes(const string &timeStr)
-{
-    stringstream ss(timeStr);
-    int hours, minutes;
-    char colon;
-    ss >> hours >> colon >> minutes;
-    return hours * 60 + minutes;
-}
-bool isTimeDifferenceSafe(const string &existingTime, const string &newTime)
+void Logger::log(LogLevel level, string text)
 {
-    int existingMinutes = timeToMinutes(existingTime);
-    int newMinutes = timeToMinutes(newTime);
+    if (!enabled(level))
+        return;
 
-    return abs(existingMinutes - newMinutes) >= 60;
-}
+    Ring &ring = ownRing();
+    size_t head = ring.head.load(memory_order_relaxed);
+    if (head - ring.tail.load(memory_order_acquire) == RING_SIZE)
+    {
+        ring.dropped.fetch_add(1, memory_order_relaxed);
+        return;
+    }
 
-// Updating a file
+    Entry &e = ring.slots[head & (RING_SIZE - 1)];
+    e.level = level;
+    clock_gettime(CLOCK_REALTIME, &e.at);
+    e.text = move(text);
+    ring.head.store(head + 1, memory_order_release);
+}
 
-void updateFile(const string &filename, const vector<vector<string>> &data)
+// Empties every ring into one write; false if there was nothing to do
+bool Logger::drain()
 {
-
-    ofstream outFile(filename);
-    if (!outFile)
+    vector<Ring *> all;
     {
-        cerr << "❌ Could not open file: " << filename << endl;
-        return;
+        lock_guard<mutex> guard(ringsLock);
+        for (auto &r : rings)
+            all.push_back(r.get());
     }
 
-    for (const auto &row : data)
+    vector<Entry> batch;
+    size_t dropped = 0;
+    for (Ring *r : all)
     {
-        for (size_t i = 0; i < row.size(); ++i)
-        {
-            outFile << escapeCSV(row[i]);
-            if (i < row.size() - 1)
-                outFile << ",";
-        }
-        outFile << "\n";
+        size_t tail = r->tail.load(memory_order_relaxed);
+        size_t head = r->head.load(memory_order_acquire);
+        for (; tail != head; ++tail)
+            batch.push_back(move(r->slots[tail & (RING_SIZE - 1)]));
+        r->tail.store(tail, memory_order_release);
+        dropped += r->dropped.exchange(0, memory_order_relaxed);
     }
+    if (batch.empty() && dropped == 0)
+        return false;
 
-    outFile.close();
-}
-
-void writeFile(const string &filename, const vector<string> &row) {
-    // Check if row is completely empty (i.e., all fields are empty)
-    bool isBlank = true;
-    for (const auto &field : row) {
-        if (!field.empty()) {
-            isBlank = false;
-            break;
-        }
-    }
+    sort(batch.begin(), batch.end(), [](const Entry &a, const Entry &b) {
+        return a.at.tv_sec != b.at.tv_sec ? a.at.tv_sec < b.at.tv_sec : a.at.tv_nsec < b.at.tv_nsec;
+    });
 
-    if (row.empty() || isBlank) {
-        // Don't write empty or all-blank lines
-        return;
+    static const char *const LEVEL_NAMES[] = {"TRACE", "INFO ", "WARN ", "ERROR"};
+    string out;
+    for (auto &e : batch)
+    {
+        char stamp[32];
+        tm local;
+        localtime_r(&e.at.tv_sec, &local);
+        size_t n = strftime(stamp, sizeof(stamp), "%H:%M:%S", &local);
+        snprintf(stamp + n, sizeof(stamp) - n, ".%03ld ", e.at.tv_nsec / 1000000);
+        out += stamp;
+        out += LEVEL_NAMES[e.level];
+        out += ' ';
+        out += e.text;
+        if (out.back() != '\n')
+            out += '\n';
     }
+    if (dropped)
+        out += "⚠️  " + to_string(dropped) + " log lines dropped (logging faster than stdout takes them)\n";
 
-    // First write using ofstream (for convenient formatting)
-    {
-        ofstream file(filename, ios::app);
-        if (!file) {
-            cerr << "❌ Could not open file: " << filename << endl;
-            return;
-        }
+    fwrite(out.data(), 1, out.size(), stdout);
+    fflush(stdout);
+    return true;
+}
 
-        for (size_t i = 0; i < row.size(); ++i) {
-            file << escapeCSV(row[i]);
-            if (i < row.size() - 1)
-                file << ",";
-        }
-        file << "\n";
+void Logger::run()
+{
+    while (!stopping.load())
+        if (!drain())
+            this_thread::sleep_for(chrono::milliseconds(10));
+    drain();
+}
 
-        // Flush C++ buffers
-        file.flush();
-    }  // ofstream closes here
+void Logger::start()
+{
+    drainer = thread(&Logger::run, this);
+}
 
-    // Then sync using file descriptor (POSIX)
-    int fd = open(filename.c_str(), O_WRONLY | O_APPEND);
-    if (fd != -1) {
-        fsync(fd);  // Force sync to disk
-        close(fd);
-    }
+void Logger::stop()
+{
+    stopping = true;
+    if (drainer.joinable())
+        drainer.join();
+    else
+        drain();                     // never started (bench, datagen): still print what was logged
 }
 
+Logger logger;
 
-// ---------- Communication Functions ----------
-void sendPrompt(int sock, const string &msg)
+// --- METRICS ---
+
+// Counters and latency histograms, served in Prometheus text format on the
+// admin port (ADMIN_PORT, loopback only). Like the logger, every thread
+// records into a shard of its own: recording is a plain load and store on
+// memory no other thread writes, with no locks and no shared cache lines,
+// and a scrape adds all the shards up. Histograms are log-linear in
+// nanoseconds, HdrHistogram style: exact below 32ns, then 16 buckets per
+// power of two, so every value is within ~6% of its bucket's bounds.
+enum MetricCounter
 {
-    // 1. Clear any pending data in the socket buffer
-    char temp_buf[256];
-    while (recv(sock, temp_buf, sizeof(temp_buf), MSG_DONTWAIT) > 0) {}
+    METRIC_SESSIONS_OPENED,
+    METRIC_SESSIONS_CLOSED,
+    METRIC_BYTES_SENT,
+    METRIC_BYTES_RECEIVED,
+    METRIC_BOOKINGS_OK,
+    METRIC_BOOKINGS_SEAT_TAKEN,
+    METRIC_BOOKINGS_NOT_SAVED,
+    METRIC_COUNTER_COUNT
+};
 
-    // 2. Send the message
-    send(sock, msg.c_str(), msg.length(), 0);
+enum MetricHistogram
+{
+    METRIC_LOGIN,
+    METRIC_VIEW_TRIPS,
+    METRIC_SEAT_CHART,
+    METRIC_BOOKING_COMMIT,
+    METRIC_FSYNC_BOOKINGS,
+    METRIC_FSYNC_APPENDS,
+    METRIC_FSYNC_SEATS,
+    METRIC_WAIT_APPEND,
+    METRIC_WAIT_IDENTITIES,
+    METRIC_WAIT_TRIPS,
+    METRIC_WAIT_BOOKING_LOG,
+    METRIC_WAIT_SEAT_HOLDS,
+    METRIC_WAIT_SEAT_CHART,
+    METRIC_WAIT_SEAT_APPEND,
+    METRIC_WAIT_TRIP_APPEND,
+    METRIC_HISTOGRAM_COUNT
+};
 
-    // 3. Force TCP buffer flush
-    int flag = 1;
-    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+struct MetricInfo
+{
+    const char *name;
+    const char *labels;
+    const char *help;
+};
 
-    // 4. Debug trace
-    cout << "[SEND] " << msg << endl;
+const MetricInfo COUNTER_INFO[METRIC_COUNTER_COUNT] = {
+    {"bus_sessions_opened_total", "", "Client connections accepted."},
+    {"bus_sessions_closed_total", "", "Client connections closed."},
+    {"bus_sent_bytes_total", "", "Bytes written to client sockets."},
+    {"bus_received_bytes_total", "", "Bytes read from client sockets."},
+    {"bus_bookings_total", "outcome=\"booked\"", "Ticket sales by outcome."},
+    {"bus_bookings_total", "outcome=\"seat_taken\"", ""},
+    {"bus_bookings_total", "outcome=\"not_saved\"", ""},
+};
 
-    // 5. Brief delay to stabilize client receive
-    usleep(10000); // 10ms
-}
+const MetricInfo HISTOGRAM_INFO[METRIC_HISTOGRAM_COUNT] = {
+    {"bus_login_seconds", "", "Checking a password at login."},
+    {"bus_view_trips_seconds", "", "Building the upcoming trips list."},
+    {"bus_seat_chart_render_seconds", "", "Rendering a seat chart, cached, patched or built."},
+    {"bus_booking_commit_seconds", "", "Waiting for a booking to be durable in the booking log."},
+    {"bus_fsync_seconds", "file=\"bookings\"", "Time in fsync, fdatasync and msync."},
+    {"bus_fsync_seconds", "file=\"appends\"", ""},
+    {"bus_fsync_seconds", "file=\"seats\"", ""},
+    {"bus_lock_wait_seconds", "lock=\"append\"", "Time spent waiting to take a lock; 0 when it was free."},
+    {"bus_lock_wait_seconds", "lock=\"identities\"", ""},
+    {"bus_lock_wait_seconds", "lock=\"trips\"", ""},
+    {"bus_lock_wait_seconds", "lock=\"booking_log\"", ""},
+    {"bus_lock_wait_seconds", "lock=\"seat_holds\"", ""},
+    {"bus_lock_wait_seconds", "lock=\"seat_chart\"", ""},
+    {"bus_lock_wait_seconds", "lock=\"seat_append\"", ""},
+    {"bus_lock_wait_seconds", "lock=\"trip_append\"", ""},
+};
 
-void sendMessage(int sock, const string &message)
+inline uint64_t metricNow()
 {
-    send(sock, message.c_str(), message.size(), 0);
-    cout << "[SEND] " << message << endl;
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
 }
 
-string receiveInput(int sock)
+class Metrics
 {
-    int flag = 1;
-    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    static const int SUB_BUCKETS = 16;
+    static const int BUCKETS = 38 * SUB_BUCKETS;     // up to 2^41ns (about 36 minutes)
 
-    char buffer[8192];
-    string input;
-    int blankInputCount = 0;
+    struct Histogram
+    {
+        atomic<uint64_t> buckets[BUCKETS];
+        atomic<uint64_t> sum;                         // nanoseconds
+    };
 
-    while (true) {
-        memset(buffer, 0, sizeof(buffer));
+    struct Shard
+    {
+        atomic<int64_t> counters[METRIC_COUNTER_COUNT];
+        Histogram histograms[METRIC_HISTOGRAM_COUNT];
+    };
 
-        // Clear any unread junk in socket buffer
-        fd_set set;
-        struct timeval timeout = {0, 1000}; // 1ms
-        FD_ZERO(&set);
-        FD_SET(sock, &set);
-        while (select(sock + 1, &set, NULL, NULL, &timeout) > 0) {
-            recv(sock, buffer, sizeof(buffer) - 1, MSG_DONTWAIT);
-        }
+    mutex shardsLock;                 // only taken when a thread records for the first time, and by scrapes
+    vector<unique_ptr<Shard>> shards;
 
-        int bytesReceived = recv(sock, buffer, sizeof(buffer) - 1, 0);
+    Shard &ownShard();
+    static size_t bucketOf(uint64_t ns);
+    static uint64_t bucketStart(size_t bucket);
 
-        if (bytesReceived == 0) {
-            cout << "[RECV] Client closed the connection.\n";
-            close(sock);
-            pthread_exit(NULL);
-        }
-        else if (bytesReceived < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                usleep(10000);
-                continue;
-            }
-            perror("[RECV] Error receiving data");
-            continue;
-        }
+    // Only the owning thread writes a shard, so no read-modify-write is needed
+    template <typename T>
+    static void bump(atomic<T> &a, T n) { a.store(a.load(memory_order_relaxed) + n, memory_order_relaxed); }
+
+public:
+    void add(MetricCounter counter, int64_t n = 1) { bump(ownShard().counters[counter], n); }
+    void observe(MetricHistogram histogram, uint64_t ns);
+    string render();
+};
 
-        buffer[bytesReceived] = '\0';
-        input = string(buffer);
+Metrics::Shard &Metrics::ownShard()
+{
+    static thread_local Shard *shard = nullptr;
+    if (!shard)
+    {
+        lock_guard<mutex> guard(shardsLock);
+        shards.push_back(make_unique<Shard>());
+        shard = shards.back().get();
+    }
+    return *shard;
+}
 
-        // Trim whitespace
-        size_t start = input.find_first_not_of(" \t\r\n");
+size_t Metrics::bucketOf(uint64_t ns)
+{
+    if (ns < 2 * SUB_BUCKETS)
+        return ns;
+    int exponent = 63 - __builtin_clzll(ns);         // ns >= 2^exponent
+    size_t bucket = (exponent - 3) * SUB_BUCKETS + ((ns >> (exponent - 4)) & (SUB_BUCKETS - 1));
+    return min<size_t>(bucket, BUCKETS - 1);
+}
 
-        /*
-        if (start == string::npos) {
-            blankInputCount++;
-            if (blankInputCount >= 2) {
-                // Allow 2nd blank input to break sync (consume junk)
-                cout << "[RECV] ⚠️  Second blank input detected. Consuming it to resync...\n";
-                blankInputCount = 0;
-                continue; // skip this input
-            } else {
-                sendPrompt(sock, "⚠️  Empty input. Please enter again:\nPROMPT@> ");
-                continue;
+uint64_t Metrics::bucketStart(size_t bucket)
+{
+    if (bucket < 2 * SUB_BUCKETS)
+        return bucket;
+    int exponent = bucket / SUB_BUCKETS + 3;
+    return (uint64_t(SUB_BUCKETS) + bucket % SUB_BUCKETS) << (exponent - 4);
+}
+
+void Metrics::observe(MetricHistogram histogram, uint64_t ns)
+{
+    Histogram &h = ownShard().histograms[histogram];
+    bump(h.buckets[bucketOf(ns)], uint64_t(1));
+    bump(h.sum, ns);
+}
+
+// Prometheus text exposition. The fine buckets are folded into a fixed
+// 1-2-5 series of bounds from 1us to 10s.
+string Metrics::render()
+{
+    static const uint64_t BOUNDS[] = {
+        1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000,
+        1000000, 2000000, 5000000, 10000000, 20000000, 50000000, 100000000, 200000000, 500000000,
+        1000000000, 2000000000, 5000000000, 10000000000};
+
+    int64_t counters[METRIC_COUNTER_COUNT] = {};
+    vector<uint64_t> buckets(METRIC_HISTOGRAM_COUNT * BUCKETS, 0);
+    uint64_t sums[METRIC_HISTOGRAM_COUNT] = {};
+    {
+        lock_guard<mutex> guard(shardsLock);
+        for (auto &shard : shards)
+        {
+            for (int c = 0; c < METRIC_COUNTER_COUNT; ++c)
+                counters[c] += shard->counters[c].load(memory_order_relaxed);
+            for (int h = 0; h < METRIC_HISTOGRAM_COUNT; ++h)
+            {
+                for (int b = 0; b < BUCKETS; ++b)
+                    buckets[h * BUCKETS + b] += shard->histograms[h].buckets[b].load(memory_order_relaxed);
+                sums[h] += shard->histograms[h].sum.load(memory_order_relaxed);
             }
         }
-        */
+    }
 
-        // If input was only spaces/newlines
-        if (start == string::npos) {
-            continue; // silently skip if you don't want to handle it anymore
-        }
+    string out;
+    auto header = [&out](const MetricInfo &info, const char *type) {
+        if (*info.help)
+            out += string("# HELP ") + info.name + " " + info.help + "\n# TYPE " + info.name + " " + type + "\n";
+    };
+    auto series = [](const MetricInfo &info, const string &extra) {
+        string labels = info.labels;
+        if (!extra.empty())
+            labels += (labels.empty() ? "" : ",") + extra;
+        return string(info.name) + (labels.empty() ? "" : "{" + labels + "}");
+    };
+
+    for (int c = 0; c < METRIC_COUNTER_COUNT; ++c)
+    {
+        header(COUNTER_INFO[c], "counter");
+        out += series(COUNTER_INFO[c], "") + " " + to_string(counters[c]) + "\n";
+    }
+    out += "# HELP bus_active_sessions Client connections open right now.\n# TYPE bus_active_sessions gauge\n";
+    out += "bus_active_sessions " + to_string(counters[METRIC_SESSIONS_OPENED] - counters[METRIC_SESSIONS_CLOSED]) + "\n";
 
-        size_t end = input.find_last_not_of(" \t\r\n");
-        input = input.substr(start, end - start + 1);
+    for (int h = 0; h < METRIC_HISTOGRAM_COUNT; ++h)
+    {
+        const MetricInfo &info = HISTOGRAM_INFO[h];
+        string name = info.name;
+        header(info, "histogram");
 
-        if (input == "A client got disconnected") {
-            cout << "⚠️  Client disconnected using Ctrl+C.\n";
-            close(sock);
-            pthread_exit(NULL);
+        uint64_t cumulative = 0;
+        int b = 0;
+        for (uint64_t bound : BOUNDS)
+        {
+            for (; b < BUCKETS && bucketStart(b) <= bound; ++b)
+                cumulative += buckets[h * BUCKETS + b];
+            char le[32];
+            snprintf(le, sizeof(le), "le=\"%g\"", bound / 1e9);
+            out += series({(name + "_bucket").c_str(), info.labels, ""}, le) + " " + to_string(cumulative) + "\n";
         }
-
-        cout << "[RECV] " << input << endl;
-        return input;
+        for (; b < BUCKETS; ++b)
+            cumulative += buckets[h * BUCKETS + b];
+        out += series({(name + "_bucket").c_str(), info.labels, ""}, "le=\"+Inf\"") + " " + to_string(cumulative) + "\n";
+        char sum[32];
+        snprintf(sum, sizeof(sum), "%.9f", sums[h] / 1e9);
+        out += series({(name + "_sum").c_str(), info.labels, ""}, "") + " " + sum + "\n";
+        out += series({(name + "_count").c_str(), info.labels, ""}, "") + " " + to_string(cumulative) + "\n";
     }
+    return out;
 }
 
+Metrics metrics;
 
+// Observes the time from construction to the end of the scope
+class MetricTimer
+{
+    MetricHistogram histogram;
+    uint64_t start;
 
-// Ignoring Case 
-bool equalsIgnoreCase(const string a, const string b) {
-    string lowerA = a;
-    string lowerB = b;
-    transform(lowerA.begin(), lowerA.end(), lowerA.begin(), ::tolower);
-    transform(lowerB.begin(), lowerB.end(), lowerB.begin(), ::tolower);
-    return lowerA == lowerB;
-}   
+public:
+    explicit MetricTimer(MetricHistogram which) : histogram(which), start(metricNow()) {}
+    ~MetricTimer() { metrics.observe(histogram, metricNow() - start); }
+};
 
+// Takes m, recording the wait under histogram. A free lock is taken with
+// try_lock and recorded as 0 without reading the clock.
+template <typename Mutex>
+unique_lock<Mutex> lockTimed(Mutex &m, MetricHistogram histogram)
+{
+    unique_lock<Mutex> guard(m, try_to_lock);
+    if (guard.owns_lock())
+    {
+        metrics.observe(histogram, 0);
+        return guard;
+    }
+    uint64_t start = metricNow();
+    guard.lock();
+    metrics.observe(histogram, metricNow() - start);
+    return guard;
+}
 
-// UPDATING SEAT FILE BY LOCKING
-mutex seatLockMutex;
+// --- LOCK PROFILING ---
 
-bool bookSeat(int sock, const string &tripId, const string &seatChoice, const string &aadhar, const string &name)
+// A ProfiledMutex charges every exclusive acquisition to the line of code
+// that made it: how often it was taken there, how often it had to wait, and
+// how long it waited for and then held the lock. Call sites are found in a
+// fixed open-addressed table keyed by lock name and source location, so a
+// lookup takes no lock and all instances of one lock (one per seat chart,
+// say) share their sites. The counts themselves go to per-thread shards, as
+// with Metrics. The admin port prints the most contended sites ("locks").
+class LockProfiler
 {
-    string seatKey = tripId + "_" + seatChoice;
+public:
+    static const size_t SITES = 256;       // power of two; the last slot collects any overflow
 
-    unique_lock<mutex> seatLock(seatLockMutex);
+private:
+    struct Site
+    {
+        atomic<uint64_t> key{0};           // 0 while the slot is free
+        atomic<bool> ready{false};         // the fields below have been filled in
+        const char *lock = "";
+        const char *function = "";
+        const char *file = "";
+        uint32_t line = 0;
+    };
 
-    string seatFile = "seat" + tripId + ".txt";
-    auto seatData = readFile(seatFile);
+    struct Stats
+    {
+        atomic<uint64_t> acquisitions, contended, waitNs, holdNs;
+    };
 
-    bool seatFoundAndBooked = false;
-    for (auto &seat : seatData)
+    struct Shard
     {
-        if (seat.size() >= 3 && seat[0] == seatChoice && seat[1] == "0")
-        {
-            seat[1] = "1";
-            seatFoundAndBooked = true;
-            break;
-        }
-    }
+        Stats stats[SITES];
+    };
 
-    if (!seatFoundAndBooked)
+    struct Totals
     {
-        sendPrompt(sock, "❌ Seat " + seatChoice + " is either already booked or invalid.\n");
-        return false;
-    }
+        uint64_t acquisitions = 0, contended = 0, waitNs = 0, holdNs = 0;
+    };
 
-    // Update the seat data after booking
-    updateFile(seatFile, seatData);
-    return true;
+    Site sites[SITES];
+    mutex shardsLock;                      // only taken when a thread locks for the first time, and by reports
+    vector<unique_ptr<Shard>> shards;
+    vector<Totals> baseline = vector<Totals>(SITES);   // subtracted by report(), set by reset()
+    uint64_t windowStart = metricNow();
+
+    Shard &ownShard();
+    vector<Totals> totalsLocked();
+
+    static void bump(atomic<uint64_t> &a, uint64_t n) { a.store(a.load(memory_order_relaxed) + n, memory_order_relaxed); }
+
+public:
+    LockProfiler();
+    size_t site(const char *lock, const source_location &where);
+    void acquired(size_t site, uint64_t waitNs);
+    void released(size_t site, uint64_t holdNs) { bump(ownShard().stats[site].holdNs, holdNs); }
+    string report(size_t top, bool reset);
+};
+
+LockProfiler::LockProfiler()
+{
+    Site &overflow = sites[SITES - 1];
+    overflow.key = 1;
+    overflow.lock = "(other)";
+    overflow.function = "(site table full)";
+    overflow.ready = true;
 }
 
-// Aadhar validation
-bool isValidAadhar(const string &aadhar)
+LockProfiler::Shard &LockProfiler::ownShard()
 {
-    return aadhar.length() == 12 && all_of(aadhar.begin(), aadhar.end(), ::isdigit);
+    static thread_local Shard *shard = nullptr;
+    if (!shard)
+    {
+        lock_guard<mutex> guard(shardsLock);
+        shards.push_back(make_unique<Shard>());
+        shard = shards.back().get();
+    }
+    return *shard;
 }
-bool isAadharExist(const string &aadhar)
+
+// The names in a source_location are string literals, so their addresses
+// identify a call site.
+size_t LockProfiler::site(const char *lock, const source_location &where)
 {
-    auto users = readFile(USER_FILE);
-    for (const auto &row : users)
-        if (row.size() > 0 && row[0] == aadhar)
-            return true;
-    return false;
-} // d
+    uint64_t key = (uintptr_t(lock) * 0x9e3779b97f4a7c15ull) ^ (uintptr_t(where.file_name()) * 0xbf58476d1ce4e5b9ull) ^
+                   (uint64_t(where.line()) * 0x94d049bb133111ebull);
+    key = (key ^ (key >> 31)) | 2;         // never 0 (free) or 1 (overflow)
 
-// License validation
-bool isValidLicense(const string &license)
+    for (size_t n = 0, i = key % (SITES - 1); n < SITES - 1; ++n, i = (i + 1) % (SITES - 1))
+    {
+        Site &s = sites[i];
+        uint64_t seen = s.key.load(memory_order_acquire);
+        if (seen == 0 && s.key.compare_exchange_strong(seen, key))
+        {
+            s.lock = lock;
+            s.function = where.function_name();
+            s.file = where.file_name();
+            s.line = where.line();
+            s.ready.store(true, memory_order_release);
+            return i;
+        }
+        if (seen == key)
+        {
+            while (!s.ready.load(memory_order_acquire))   // another thread is filling it in
+                this_thread::yield();
+            return i;
+        }
+    }
+    return SITES - 1;
+}
+
+void LockProfiler::acquired(size_t site, uint64_t waitNs)
 {
-    return (license.length() == 16);
+    Stats &s = ownShard().stats[site];
+    bump(s.acquisitions, 1);
+    if (waitNs)
+    {
+        bump(s.contended, 1);
+        bump(s.waitNs, waitNs);
+    }
 }
 
-bool isLicenseExist(const string &license)
+vector<LockProfiler::Totals> LockProfiler::totalsLocked()
 {
-    auto users = readFile(DRIVER_FILE);
-    for (const auto &row : users)
-        if (row.size() > 0 && row[1] == license)
-            return true;
-    return false;
-} // d
+    vector<Totals> totals(SITES);
+    for (auto &shard : shards)
+        for (size_t i = 0; i < SITES; ++i)
+        {
+            Stats &s = shard->stats[i];
+            totals[i].acquisitions += s.acquisitions.load(memory_order_relaxed);
+            totals[i].contended += s.contended.load(memory_order_relaxed);
+            totals[i].waitNs += s.waitNs.load(memory_order_relaxed);
+            totals[i].holdNs += s.holdNs.load(memory_order_relaxed);
+        }
+    return totals;
+}
 
-// CURRENT TIME CHECKING
+// The top sites by total wait since start or the last reset. With reset set,
+// the next report starts counting from now.
+string LockProfiler::report(size_t top, bool reset)
+{
+    vector<Totals> totals;
+    uint64_t since;
+    {
+        lock_guard<mutex> guard(shardsLock);
+        totals = totalsLocked();
+        for (size_t i = 0; i < SITES; ++i)
+        {
+            Totals now = totals[i];
+            totals[i].acquisitions -= baseline[i].acquisitions;
+            totals[i].contended -= baseline[i].contended;
+            totals[i].waitNs -= baseline[i].waitNs;
+            totals[i].holdNs -= baseline[i].holdNs;
+            if (reset)
+                baseline[i] = now;
+        }
+        since = windowStart;
+        if (reset)
+            windowStart = metricNow();
+    }
 
-// bool isTimeAfterNow(const string &timeStr)
-// {
-//     int tripHour, tripMin;
-//     char colon;
-//     stringstream ss(timeStr);
-//     if (!(ss >> tripHour >> colon >> tripMin) || colon != ':')
-//     {
-//         return false; // Invalid time
-//     }
+    vector<size_t> order;
+    for (size_t i = 0; i < SITES; ++i)
+        if (totals[i].acquisitions && sites[i].ready.load(memory_order_acquire))
+            order.push_back(i);
+    sort(order.begin(), order.end(), [&totals](size_t a, size_t b) {
+        if (totals[a].waitNs != totals[b].waitNs)
+            return totals[a].waitNs > totals[b].waitNs;
+        return totals[a].holdNs > totals[b].holdNs;
+    });
+    if (order.size() > top)
+        order.resize(top);
+
+    // "bool SeatHolds::hold(const string&, ...)" -> "SeatHolds::hold"
+    auto shortName = [](string_view f) {
+        f = f.substr(0, f.find('('));
+        size_t space = f.rfind(' ');
+        return string(space == string_view::npos ? f : f.substr(space + 1));
+    };
 
-//     time_t now = time(0);
-//     tm *ltm = localtime(&now);
-//     int currMinutes = ltm->tm_hour * 60 + ltm->tm_min;
-//     int tripMinutes = tripHour * 60 + tripMin;
+    char line[256];
+    snprintf(line, sizeof(line), "Lock contention over the last %.1fs, top %zu sites by time spent waiting\n",
+             (metricNow() - since) / 1e9, order.size());
+    string out = line;
+    snprintf(line, sizeof(line), "%-12s %-40s %10s %10s %10s %10s %10s %10s\n",
+             "lock", "site", "acquired", "contended", "wait ms", "avg wait", "hold ms", "avg hold");
+    out += line;
+    for (size_t i : order)
+    {
+        const Site &s = sites[i];
+        const Totals &t = totals[i];
+        string where = shortName(s.function);
+        if (s.line)
+        {
+            const char *file = strrchr(s.file, '/');
+            where += string(" ") + (file ? file + 1 : s.file) + ":" + to_string(s.line);
+        }
+        char contended[16];
+        snprintf(contended, sizeof(contended), "%.1f%%", 100.0 * t.contended / t.acquisitions);
+        snprintf(line, sizeof(line), "%-12s %-40s %10llu %10s %10.3f %8.1fus %10.3f %8.1fus\n",
+                 s.lock, where.c_str(), (unsigned long long)t.acquisitions, contended,
+                 t.waitNs / 1e6, t.contended ? t.waitNs / 1e3 / t.contended : 0.0,
+                 t.holdNs / 1e6, t.holdNs / 1e3 / t.acquisitions);
+        out += line;
+    }
+    return out;
+}
 
-//     return tripMinutes > currMinutes;
-// } // d
+LockProfiler lockProfiler;
 
-bool isDateTimeAfterNow(const string &dateTimeStr)
+// Drop-in replacement for mutex or shared_mutex that reports to lockProfiler.
+// Take it with lockTimed() (or call lock() directly) so the site recorded is
+// the caller's: a std::lock_guard would record its own line in <mutex>. The
+// shared side is passed straight through, since readers do not exclude each
+// other and a writer's wait already includes them.
+template <typename Mutex>
+class ProfiledMutex
 {
-    tm trip_tm = {};
-    if (strptime(dateTimeStr.c_str(), "%a %b %d %H:%M:%S %Y", &trip_tm) == nullptr)
-    {
-        return false; // Invalid datetime format
-    }
+    Mutex m;
+    const char *name;
+    size_t holder = 0;                     // site of the current owner; only touched while m is held
+    uint64_t lockedAt = 0;
 
-    time_t trip_time = mktime(&trip_tm);
-    time_t now_time = time(nullptr);
+public:
+    explicit ProfiledMutex(const char *lockName) : name(lockName) {}
 
-    return difftime(trip_time, now_time) > 0;
-}
-// int getMinutesFromDateTime(const string &dateTimeStr)
-time_t getTimeFromDateTime(const string &dateTimeStr)
+    uint64_t lockAt(const source_location &where);   // returns how long it waited, 0 if the lock was free
+    void lock(const source_location &where = source_location::current()) { lockAt(where); }
+    bool try_lock(const source_location &where = source_location::current());
+    void unlock();
+
+    void lock_shared() { m.lock_shared(); }
+    bool try_lock_shared() { return m.try_lock_shared(); }
+    void unlock_shared() { m.unlock_shared(); }
+};
+
+template <typename Mutex>
+uint64_t ProfiledMutex<Mutex>::lockAt(const source_location &where)
 {
-    tm trip_tm = {};
-    if (strptime(dateTimeStr.c_str(), "%a %b %d %H:%M:%S %Y", &trip_tm) == nullptr)
+    size_t site = lockProfiler.site(name, where);
+    uint64_t waited = 0;
+    if (!m.try_lock())
     {
-        return -1; // Error
+        uint64_t start = metricNow();
+        m.lock();
+        waited = max<uint64_t>(metricNow() - start, 1);
     }
-    // return trip_tm.tm_hour * 60 + trip_tm.tm_min;
-    return mktime(&trip_tm); // full datetime in seconds since epoch
+    holder = site;
+    lockProfiler.acquired(site, waited);
+    lockedAt = metricNow();
+    return waited;
 }
 
-//Printing the SEAT MATRIX 
-
-void seatMatrix(const string &tripId, int rows, int cols, int sock) {
-    string seatFile = "seat" + tripId + ".txt";
-    auto seatData = readFile(seatFile); // Load seat data
-
-    stringstream response;
-    response << "SEAT CHART FOR THE TRIP " << tripId << "\n";
+template <typename Mutex>
+bool ProfiledMutex<Mutex>::try_lock(const source_location &where)
+{
+    if (!m.try_lock())
+        return false;
+    holder = lockProfiler.site(name, where);
+    lockProfiler.acquired(holder, 0);
+    lockedAt = metricNow();
+    return true;
+}
 
-    // GATE and driver header
-   stringstream ss;
-ss << "\n╔═══════════════════════════════╗";
-ss << "\n║         BUS SEAT STATUS       ║";
-ss << "\n╠═══════╦═══════════════════════╣";
-ss << "\n║ G     ║    DRIVER SEAT        ║";
-ss << "\n║       ╠═══════════════════════╣";
-ss << "\n║ A     ║ Seat Position: Optimal║";
-ss << "\n║ T     ║ Temperature:  22°C    ║";
-ss << "\n║ E     ║ Occupancy:    Detected║";
-ss << "\n╚═══════╩═══════════════════════╝";
-response << ss.str() << "\n\n";
+template <typename Mutex>
+void ProfiledMutex<Mutex>::unlock()
+{
+    size_t site = holder;
+    uint64_t held = metricNow() - lockedAt;
+    m.unlock();
+    lockProfiler.released(site, held);
+}
 
-    int leftCols = cols / 2;
-    int rightCols = cols - leftCols;
-    int totalSeats = rows * cols;
-    int seatIndex = 0;
+// lockTimed() for a profiled lock: the wait is measured once and recorded
+// both in the histogram and against the caller's line
+template <typename Mutex>
+unique_lock<ProfiledMutex<Mutex>> lockTimed(ProfiledMutex<Mutex> &m, MetricHistogram histogram,
+                                            const source_location &where = source_location::current())
+{
+    metrics.observe(histogram, m.lockAt(where));
+    return unique_lock<ProfiledMutex<Mutex>>(m, adopt_lock);
+}
 
-    for (int row = 0; row < rows; ++row) {
-        stringstream iconLine;
-        stringstream numberLine;
+// Appends to buses.txt
+ProfiledMutex<mutex> mtx("append");
 
-        iconLine << "|";
-        numberLine << "|";
+// --- SPAN TRACING ---
 
-        // Left side
-        for (int i = 0; i < leftCols; ++i) {
-            if (seatIndex < seatData.size() && seatData[seatIndex].size() >= 2) {
-                string status = seatData[seatIndex][1];
-                string seatIcon = (status == "0") ? "💺" : "❌";
-                iconLine << setw(2) << seatIcon << " ";
-                numberLine << setw(2) << setfill('0') << seatData[seatIndex][0] << " ";
-            } else {
-                iconLine << setw(3) << " ";
-                numberLine << setw(3) << " ";
-            }
-            ++seatIndex;
-        }
+// Timed spans of server work, each tagged with the session it was done for,
+// kept in memory and exported as Chrome trace-event JSON (open it in
+// chrome://tracing or Perfetto), one row per session. Tracing is off unless
+// the server is started with --spans or the admin port is sent "spans on";
+// while it is off a Span costs one relaxed load. Every thread writes to a
+// ring of its own that keeps its most recent RING_SIZE spans, so recording
+// never takes a lock and old spans are simply overwritten.
+class SpanTracer
+{
+    static const size_t RING_SIZE = 1 << 14;    // per thread, a power of two
 
-        // Middle aisle spacing
-        int aisleSpacing = 31 - (leftCols + rightCols) * 3 - 2; // 2 for '|'
-        iconLine << string(aisleSpacing, ' ');
-        numberLine << string(aisleSpacing, ' ');
+    struct Record
+    {
+        atomic<const char *> name;
+        atomic<uint64_t> session, start, end;
+    };
 
-        // Right side
-        for (int i = 0; i < rightCols; ++i) {
-            if (seatIndex < seatData.size() && seatData[seatIndex].size() >= 2) {
-                string status = seatData[seatIndex][1];
-                string seatIcon = (status == "0") ? "💺" : "❌";
-                iconLine << setw(2) << seatIcon << " ";
-                numberLine << setw(2) << setfill('0') << seatData[seatIndex][0] << " ";
-            } else {
-                iconLine << setw(3) << " ";
-                numberLine << setw(3) << " ";
-            }
-            ++seatIndex;
-        }
+    // A seqlock over the slots: claimed moves before a slot is rewritten and
+    // written after, so a reader can tell which of its copies may be torn
+    struct Ring
+    {
+        atomic<uint64_t> claimed{0}, written{0};
+        Record records[RING_SIZE];
+        size_t thread = 0;
+    };
 
-        iconLine << " |";
-        numberLine << " |";
+    struct Copy
+    {
+        const char *name;
+        uint64_t session, start, end;
+        size_t thread;
+    };
 
-        response << iconLine.str() << "\n";
-        response << numberLine.str() << "\n";
-    }
-    response << "\n|===============================|";
-    response << "\n 💺 = Available, ❌ = Booked\n";
+    atomic<bool> on{false};
+    mutex ringsLock;                 // only taken when a thread records for the first time, and by exports
+    vector<unique_ptr<Ring>> rings;
 
-    // Collect price details
-    string windowPrice = "N/A";
-    string middlePrice = "N/A";
-    string backWindowPrice = "N/A";
-    string backMiddlePrice = "N/A";
+    Ring &ownRing();
 
-    if (!seatData.empty()) {
-        // Window seat (first seat)
-        if (seatData[0].size() >= 3) {
-            windowPrice = seatData[0][2];
-        }
+public:
+    bool enabled() const { return on.load(memory_order_relaxed); }
+    void enable(bool yes) { on.store(yes, memory_order_relaxed); }
+    void record(const char *name, uint64_t session, uint64_t start, uint64_t end);
+    string exportJson();
+};
 
-        // Middle seat (if cols > 2)
-        if (cols > 2) {
-            if (seatData.size() > 1 && seatData[1].size() >= 3) {
-                middlePrice = seatData[1][2];
-            } else {
-                middlePrice = "N/A";
-            }
-        }
+SpanTracer::Ring &SpanTracer::ownRing()
+{
+    static thread_local Ring *ring = nullptr;
+    if (!ring)
+    {
+        lock_guard<mutex> guard(ringsLock);
+        rings.push_back(make_unique<Ring>());
+        ring = rings.back().get();
+        ring->thread = rings.size();
+    }
+    return *ring;
+}
 
-        // Back window seat
-        int backRowIndex = (rows - 1) * cols;
-        if (backRowIndex < seatData.size() && seatData[backRowIndex].size() >= 3) {
-            backWindowPrice = seatData[backRowIndex][2];
-        }
+void SpanTracer::record(const char *name, uint64_t session, uint64_t start, uint64_t end)
+{
+    Ring &ring = ownRing();
+    uint64_t n = ring.written.load(memory_order_relaxed);
+    ring.claimed.store(n + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    Record &r = ring.records[n & (RING_SIZE - 1)];
+    r.name.store(name, memory_order_relaxed);
+    r.session.store(session, memory_order_relaxed);
+    r.start.store(start, memory_order_relaxed);
+    r.end.store(end, memory_order_relaxed);
+    ring.written.store(n + 1, memory_order_release);
+}
 
-        // Back middle seat (if cols > 2)
-        if (cols > 2) {
-            int backMiddleIndex = backRowIndex + 1;
-            if (backMiddleIndex < seatData.size() && seatData[backMiddleIndex].size() >= 3) {
-                backMiddlePrice = seatData[backMiddleIndex][2];
-            } else {
-                backMiddlePrice = "N/A";
+// Complete ("X") events with microsecond timestamps; tid is the session, so
+// each client gets its own row. Work done for no session is on row 0.
+string SpanTracer::exportJson()
+{
+    vector<Copy> spans;
+    {
+        lock_guard<mutex> guard(ringsLock);
+        for (auto &ring : rings)
+        {
+            uint64_t end = ring->written.load(memory_order_acquire);
+            uint64_t begin = end > RING_SIZE ? end - RING_SIZE : 0;
+            vector<Copy> copies;
+            for (uint64_t i = begin; i < end; ++i)
+            {
+                Record &r = ring->records[i & (RING_SIZE - 1)];
+                copies.push_back({r.name.load(memory_order_relaxed), r.session.load(memory_order_relaxed),
+                                  r.start.load(memory_order_relaxed), r.end.load(memory_order_relaxed), ring->thread});
             }
+            // Slots the owner has started reusing since we read them may be torn
+            atomic_thread_fence(memory_order_acquire);
+            uint64_t claimed = ring->claimed.load(memory_order_relaxed);
+            uint64_t firstIntact = claimed > RING_SIZE ? claimed - RING_SIZE : 0;
+            if (firstIntact > begin)
+                copies.erase(copies.begin(), copies.begin() + min<uint64_t>(firstIntact - begin, copies.size()));
+            spans.insert(spans.end(), copies.begin(), copies.end());
         }
     }
 
-    // Build the price details response
-    response << "\n IMPORTANT PRICE DETAILS\n";
-    if (cols > 2) {
-        response << "1. LOWER PRICE FOR MIDDLE SEATS: " << middlePrice << "\n";
-    } else {
-        response << "1. LOWER PRICE FOR MIDDLE SEATS: Not applicable (no middle seats in 2-column layout)\n";
-    }
+    // Enclosing spans first, so viewers nest them correctly
+    sort(spans.begin(), spans.end(), [](const Copy &a, const Copy &b) {
+        return a.start != b.start ? a.start < b.start : a.end > b.end;
+    });
 
-    response << "2. MORE LOWER PRICES FOR BACK SEATS -> BACK WINDOW: " << backWindowPrice;
-    if (cols > 2) {
-        response << ", BACK MIDDLE: " << backMiddlePrice;
+    string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    set<uint64_t> sessions;
+    char line[256];
+    for (auto &s : spans)
+    {
+        snprintf(line, sizeof(line),
+                 "{\"name\":\"%s\",\"cat\":\"bus\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%llu,"
+                 "\"args\":{\"thread\":%zu}},\n",
+                 s.name, s.start / 1e3, (s.end - s.start) / 1e3, (unsigned long long)s.session, s.thread);
+        out += line;
+        sessions.insert(s.session);
     }
-    response << "\n";
-
-    response << "3. PRICE HIKE FOR WINDOW SEATS: " << windowPrice << "\n";
-
-    sendMessage(sock, response.str());
+    for (uint64_t session : sessions)
+    {
+        string label = session ? "session " + to_string(session) : "server";
+        snprintf(line, sizeof(line), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%llu,\"args\":{\"name\":\"%s\"}},\n",
+                 (unsigned long long)session, label.c_str());
+        out += line;
+    }
+    if (out.back() == '\n' && out[out.size() - 2] == ',')
+        out.erase(out.size() - 2, 1);
+    out += "]}\n";
+    return out;
 }
 
-// --- CLASS DECLARATIONS ---
+SpanTracer spans;
 
-class User
-{
-public:
-    void registerUser(int sock);
-    string login(int sock);
-};
+// The session whose job this thread is running; set by Session::runJobs
+thread_local uint64_t spanSession = 0;
 
-// reservation handler
-class ReservationHandler
+// Records the time from construction to the end of the scope as one span.
+// name must be a string literal: only the pointer is kept.
+class Span
 {
-private:
-    string uid;
-
-public:
-    ReservationHandler(string userID) : uid(userID) {}
-
-    void viewTickets(int sock);
-    vector<vector<string>> viewTrips(int sock);
-    void reserve(int sock);
-};
+    const char *name;
+    uint64_t session = 0;
+    uint64_t start = 0;              // 0 when tracing was off at construction
 
-// driver class
-class Driver
-{
 public:
-    void registerDriver(int sock);
-    string loginDriver(int sock);
+    explicit Span(const char *what) : name(what)
+    {
+        if (spans.enabled())
+        {
+            session = spanSession;
+            start = metricNow();
+        }
+    }
+    ~Span()
+    {
+        if (start)
+            spans.record(name, session, start, metricNow());
+    }
+    Span(const Span &) = delete;
+    Span &operator=(const Span &) = delete;
 };
 
-//------BUS_TRIP_HANDLER-------------
+// --- UTILITY ---
 
-class bus_trip_handler
+// Read from a file
+//
+// The whole file is read into one buffer with a single read() and split in
+// place: every cell is a string_view into that buffer, so parsing allocates
+// nothing per cell or per line. Quoted fields written by escapeCSV() are
+// unescaped in place ("" -> ") and may span lines. Blank lines are skipped.
+// Views stay valid for as long as the CsvFile lives.
+class CsvFile
 {
-    string aadhar;
+    string buffer;
+    vector<string_view> cells;
+    vector<size_t> rowStart;   // index of each row's first cell, plus one past the end
+
+    void parse();
 
 public:
-    bus_trip_handler(string a) : aadhar(a) {}; // constructor
+    struct Row
+    {
+        const string_view *first;
+        size_t count;
+
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        string_view operator[](size_t i) const { return first[i]; }
+        const string_view *begin() const { return first; }
+        const string_view *end() const { return first + count; }
+    };
 
-    void registerBus(int sock);
-    void insertTrip(int sock);
-    void createSeatFile(const string &tripId, int row, int col,float dist);
+    struct iterator
+    {
+        const CsvFile *file;
+        size_t i;
+        Row operator*() const { return (*file)[i]; }
+        iterator &operator++() { ++i; return *this; }
+        bool operator!=(const iterator &o) const { return i != o.i; }
+    };
 
-private:
-    string generateTripID()
-    {       
-    auto trips = readFile(TRIPS_FILE);
-    int maxID = 0;
+    bool load(const string &filename);
+    size_t size() const { return rowStart.empty() ? 0 : rowStart.size() - 1; }
+    Row operator[](size_t i) const
+    {
+        return {cells.data() + rowStart[i], rowStart[i + 1] - rowStart[i]};
+    }
+    iterator begin() const { return {this, 0}; }
+    iterator end() const { return {this, size()}; }
+};
 
-    std::regex idPattern(R"(T(\d+))");
+bool CsvFile::load(const string &filename)
+{
+    buffer.clear();
+    cells.clear();
+    rowStart.clear();
 
-    for (const auto& trip : trips) {
-        if (trip.empty()) continue;
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
 
-        std::smatch match;
-        if (std::regex_match(trip[0], match, idPattern)) {
-            int idNum = std::stoi(match[1]);
-            if (idNum > maxID) {
-                maxID = idNum;
-            }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        buffer.resize(st.st_size);
+        size_t off = 0;
+        while (off < buffer.size())
+        {
+            ssize_t n = read(fd, &buffer[off], buffer.size() - off);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                break;
+            off += n;
         }
+        buffer.resize(off);
     }
+    close(fd);
 
-    stringstream ss;
-    ss << "T" << setfill('0') << setw(3) << (maxID + 1);
-    return ss.str();
+    parse();
+    return true;
 }
-}; // d
 
-// --------- Create Seat File Function----------
-void bus_trip_handler::createSeatFile(const string &tripId, int rows, int cols, float dist)
+void CsvFile::parse()
 {
-    int k = 1;
-    for (int r = 0; r < rows; r++)
+    // A row has at most one cell per separator, so this is the only growth
+    size_t commas = 0, newlines = 0;
+    for (char c : buffer)
     {
-        for (int c = 0; c < cols; ++c)
-        {
-            string seatNum = to_string(k);
-            string status = "0";
+        commas += (c == ',');
+        newlines += (c == '\n');
+    }
+    cells.reserve(commas + newlines + 1);
+    rowStart.reserve(newlines + 2);
 
-            int baseprice;
+    char *p = &buffer[0];
+    char *end = p + buffer.size();
 
-            // Check for back row seats first
-            if ((r == rows - 1) && (c == 0 || c == cols - 1))
-            {
-                baseprice = 105; // Back window seats
-            }
-            else if (r == rows - 1)
-            {
-                baseprice = 100; // Back middle seats
-            }
-            else if (c == 0 || c == cols - 1)
+    while (p < end)
+    {
+        if (*p == '\n' || (*p == '\r' && p + 1 < end && p[1] == '\n'))
+        {
+            p += (*p == '\r') ? 2 : 1;   // blank line
+            continue;
+        }
+
+        rowStart.push_back(cells.size());
+        while (true)
+        {
+            char *cellBegin = p;
+            char *cellEnd;
+            if (p < end && *p == '"')
             {
-                baseprice = 150; // Window seats (not back row)
+                // Quoted: compact doubled quotes towards the front as we go
+                char *w = ++p;
+                cellBegin = w;
+                while (p < end)
+                {
+                    if (*p == '"')
+                    {
+                        if (p + 1 < end && p[1] == '"')
+                        {
+                            *w++ = '"';
+                            p += 2;
+                            continue;
+                        }
+                        ++p;   // closing quote
+                        break;
+                    }
+                    *w++ = *p++;
+                }
+                cellEnd = w;
+                while (p < end && *p != ',' && *p != '\n')
+                    ++p;   // tolerate junk between closing quote and separator
             }
             else
             {
-                baseprice = 120; // Middle seats (not back row)
+                while (p < end && *p != ',' && *p != '\n')
+                    ++p;
+                cellEnd = p;
             }
 
-            // Calculate price based on distance
-            int multiplier = ceil(dist / 80.0);
-            int price = baseprice * multiplier;
+            if (cellEnd > cellBegin && cellEnd[-1] == '\r' && (p >= end || *p == '\n'))
+                --cellEnd;
+            cells.emplace_back(cellBegin, cellEnd - cellBegin);
 
-            vector<string> row = {seatNum, status, to_string(price)};
-            writeFile("seat" + tripId + ".txt", row);
-            k++;
+            if (p >= end || *p == '\n')
+            {
+                if (p < end)
+                    ++p;
+                break;
+            }
+            ++p;   // ','
         }
     }
+    rowStart.push_back(cells.size());
 }
 
-// --- USER METHODS ---
-
-//------------USER REGISTER--------------------------
-void User::registerUser(int sock)
+// string_view -> int without going through a temporary std::string
+bool parseInt(string_view sv, int &out)
 {
-    sendPrompt(sock, "Enter your Name:PROMPT@");
-    string name = receiveInput(sock);
+    auto r = from_chars(sv.data(), sv.data() + sv.size(), out);
+    return r.ec == errc() && r.ptr == sv.data() + sv.size();
+}
 
-    int age = 0;
-    while (true)
+// BusNo -> (rows, cols) for every bus in buses.txt
+unordered_map<string, pair<int, int>> loadBusLayouts()
+{
+    unordered_map<string, pair<int, int>> layouts;
+    CsvFile buses;
+    buses.load(BUS_FILE);
+    for (auto bus : buses)
     {
-        sendPrompt(sock, "Enter your Age:PROMPT@");
-        string ageinput = receiveInput(sock);
-        try
-        {
-            age = stoi(ageinput);
-            if (age < 1)
-                sendMessage(sock, "Children below 1 year of age are not eligible for safety concerns.\n");
-            else if (age > 150)
-                sendMessage(sock, "❌ Enter realistic age data.\n");
-            else
-                break;
-        }
-        catch (invalid_argument &e)
-        {
-            sendMessage(sock, "❌ Invalid input. Please enter a number for age.\n");
-        }
+        int rows, cols;
+        if (bus.size() >= 4 && parseInt(bus[2], rows) && parseInt(bus[3], cols))
+            layouts[string(bus[0])] = {rows, cols};
     }
+    return layouts;
+}
 
-    string aadhar;
-    while (true)
-    {
-        sendPrompt(sock, "Enter your Unique Aadhar number:PROMPT@");
-        aadhar = receiveInput(sock);
-        if (!isValidAadhar(aadhar))
-        {
-            sendMessage(sock, "❌ Invalid Aadhar number. It must be 12 digits.\n");
-            continue;
-        }
-        if (isAadharExist(aadhar))
-        {
-            sendPrompt(sock, "This Aadhar number is already registered.\nIs it a Typo error? (y/n): PROMPT@");
-            string ans = receiveInput(sock);
-            if (ans == "y" || ans == "Y")
-            {
-                sendMessage(sock, "No worries, Re-enter again.\n");
-                continue;
-            }
-            else
-            {
-                sendMessage(sock, "You're already registered. Please login instead.\n");
-                return;
+// Seat layout of a single bus; false if the bus is not registered
+bool findBusLayout(const string &busNo, int &rows, int &cols)
+{
+    CsvFile buses;
+    buses.load(BUS_FILE);
+    for (auto bus : buses)
+        if (bus.size() >= 4 && bus[0] == busNo)
+            return parseInt(bus[2], rows) && parseInt(bus[3], cols);
+    return false;
+}
+
+
+void hash_password(const char *password, char *output)
+{
+    unsigned char hash[SHA256_DIGEST_LENGTH];
+    SHA256((const unsigned char *)password, strlen(password), hash);
+    for (int i = 0; i < SHA256_DIGEST_LENGTH; i++)
+        sprintf(output + (i * 2), "%02x", hash[i]);
+    output[SHA256_DIGEST_LENGTH * 2] = '\0';
+}
+string extractTime(const string &dateTime) {
+    // Example: "Thu May 15 06:45:00 2025" --> "06:45"
+    size_t timeStart = dateTime.find(':') - 2;
+    return dateTime.substr(timeStart, 5); // extracts "06:45"
+}
+string extractDateDDMMYYYY(const string &dateTime) {
+    // input: "Thu May 15 06:45:00 2025"
+    // output: "15/05/2025"
+    istringstream iss(dateTime);
+    string dayOfWeek, monthStr, dayStr, timeStr, yearStr;
+    iss >> dayOfWeek >> monthStr >> dayStr >> timeStr >> yearStr;
+
+    // Convert month name to number
+    map<string, string> monthMap = {
+        {"Jan", "01"}, {"Feb", "02"}, {"Mar", "03"}, {"Apr", "04"},
+        {"May", "05"}, {"Jun", "06"}, {"Jul", "07"}, {"Aug", "08"},
+        {"Sep", "09"}, {"Oct", "10"}, {"Nov", "11"}, {"Dec", "12"}
+    };
+
+    string month = monthMap[monthStr];
+
+    if (dayStr.length() == 1) dayStr = "0" + dayStr;
+
+    return dayStr + "/" + month + "/" + yearStr;
+}
+
+
+
+// Ignoring Case 
+bool equalsIgnoreCase(const string a, const string b) {
+    string lowerA = a;
+    string lowerB = b;
+    transform(lowerA.begin(), lowerA.end(), lowerA.begin(), ::tolower);
+    transform(lowerB.begin(), lowerB.end(), lowerB.begin(), ::tolower);
+    return lowerA == lowerB;
+}
+
+string trim(const string &s)
+{
+    size_t start = s.find_first_not_of(" \t\n\r");
+    size_t end = s.find_last_not_of(" \t\n\r");
+    if (start == string::npos || end == string::npos)
+        return "";
+    return s.substr(start, end - start + 1);
+}
+
+// Escape special characters in CSV
+string escapeCSV(const string &field)
+{
+    string escaped = field;
+    bool needsQuotes = escaped.find(',') != string::npos ||
+                       escaped.find('"') != string::npos ||
+                       escaped.find('\n') != string::npos;
+
+    if (needsQuotes)
+    {
+        size_t pos = 0;
+        while ((pos = escaped.find('"', pos)) != string::npos)
+        {
+            escaped.insert(pos, "\""); // Escape quotes by doubling them
+            pos += 2;
+        }
+        escaped = "\"" + escaped + "\"";
+    }
+
+    return escaped;
+}
+
+// FOR FINDING UPCOMING TRIPS ++ DYNAMIC PRICING
+int timeToMinutes(const string &timeStr)
+{
+    stringstream ss(timeStr);
+    int hours, minutes;
+    char colon;
+    ss >> hours >> colon >> minutes;
+    return hours * 60 + minutes;
+}
+bool isTimeDifferenceSafe(const string &existingTime, const string &newTime)
+{
+    int existingMinutes = timeToMinutes(existingTime);
+    int newMinutes = timeToMinutes(newTime);
+
+    return abs(existingMinutes - newMinutes) >= 60;
+}
+
+// Departure strings look like "Thu May 15 06:45:00 2025"
+bool isDateTimeAfterNow(const string &dateTimeStr)
+{
+    tm trip_tm = {};
+    if (strptime(dateTimeStr.c_str(), "%a %b %d %H:%M:%S %Y", &trip_tm) == nullptr)
+    {
+        return false; // Invalid datetime format
+    }
+
+    time_t trip_time = mktime(&trip_tm);
+    time_t now_time = time(nullptr);
+
+    return difftime(trip_time, now_time) > 0;
+}
+// int getMinutesFromDateTime(const string &dateTimeStr)
+time_t getTimeFromDateTime(const string &dateTimeStr)
+{
+    tm trip_tm = {};
+    if (strptime(dateTimeStr.c_str(), "%a %b %d %H:%M:%S %Y", &trip_tm) == nullptr)
+    {
+        return -1; // Error
+    }
+    // return trip_tm.tm_hour * 60 + trip_tm.tm_min;
+    return mktime(&trip_tm); // full datetime in seconds since epoch
+}
+
+// Updating a file
+
+void updateFile(const string &filename, const vector<vector<string>> &data)
+{
+
+    ofstream outFile(filename);
+    if (!outFile)
+    {
+        logger.log(LOG_ERROR, "❌ Could not open file: " + filename);
+        return;
+    }
+
+    for (const auto &row : data)
+    {
+        for (size_t i = 0; i < row.size(); ++i)
+        {
+            outFile << escapeCSV(row[i]);
+            if (i < row.size() - 1)
+                outFile << ",";
+        }
+        outFile << "\n";
+    }
+
+    outFile.close();
+}
+
+// One CSV line, fields escaped, with the trailing newline
+string toCSVLine(const vector<string> &row)
+{
+    string line;
+    for (size_t i = 0; i < row.size(); ++i)
+    {
+        line += escapeCSV(row[i]);
+        if (i < row.size() - 1)
+            line += ",";
+    }
+    line += "\n";
+    return line;
+}
+
+void writeFile(const string &filename, const vector<string> &row) {
+    Span span("writeFile");
+    // Check if row is completely empty (i.e., all fields are empty)
+    bool isBlank = true;
+    for (const auto &field : row) {
+        if (!field.empty()) {
+            isBlank = false;
+            break;
+        }
+    }
+
+    if (row.empty() || isBlank) {
+        // Don't write empty or all-blank lines
+        return;
+    }
+
+    // First write using ofstream (for convenient formatting)
+    {
+        ofstream file(filename, ios::app);
+        if (!file) {
+            logger.log(LOG_ERROR, "❌ Could not open file: " + filename);
+            return;
+        }
+
+        file << toCSVLine(row);
+
+        // Flush C++ buffers
+        file.flush();
+    }  // ofstream closes here
+
+    // Then sync using file descriptor (POSIX)
+    int fd = open(filename.c_str(), O_WRONLY | O_APPEND);
+    if (fd != -1) {
+        MetricTimer timer(METRIC_FSYNC_APPENDS);
+        fsync(fd);  // Force sync to disk
+        close(fd);
+    }
+}
+
+// Appends many rows with a single write and a single fsync
+bool writeRows(const string &filename, const vector<vector<string>> &rows)
+{
+    Span span("writeRows");
+    string data;
+    for (const auto &row : rows)
+        data += toCSVLine(row);
+    if (data.empty())
+        return true;
+
+    int fd = open(filename.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd == -1) {
+        logger.log(LOG_ERROR, "❌ Could not open file: " + filename + ": " + strerror(errno));
+        return false;
+    }
+
+    size_t off = 0;
+    while (off < data.size()) {
+        ssize_t n = write(fd, data.data() + off, data.size() - off);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0) {
+            logger.log(LOG_ERROR, "❌ Could not write file: " + filename + ": " + strerror(errno));
+            close(fd);
+            return false;
+        }
+        off += n;
+    }
+    {
+        MetricTimer timer(METRIC_FSYNC_APPENDS);
+        fsync(fd);
+    }
+    close(fd);
+    return true;
+}
+
+// --- BOOKING LOG ---
+
+// bookings.txt is an append-only write-ahead log. Sessions hand their rows
+// to a single writer thread which gathers everything that queued up while
+// the previous fsync was in flight and commits it with one write and one
+// fdatasync. Callers wait on the returned future, so a booking is only
+// reported once it is on disk, but a rush of bookings shares the sync cost.
+class BookingLog
+{
+    struct PendingCommit
+    {
+        string lines;
+        function<void(bool)> done;  // called on the writer thread once the batch is synced (or failed)
+    };
+
+    mutex queueLock;
+    condition_variable queueReady;
+    vector<PendingCommit> pending;
+    bool stopping = false;
+    int fd = -1;
+    off_t durableSize = 0;          // bytes known to be synced; a failed batch is cut back to this
+    thread writer;
+
+    void run();
+    bool writeAll(const string &data);
+    bool repairTail();
+
+public:
+    bool open(const string &filename);
+    future<bool> commit(const vector<string> &row);
+    future<bool> commit(const vector<vector<string>> &rows);   // all land in one write
+    void commit(const vector<vector<string>> &rows, function<void(bool)> done);
+    void close();
+};
+
+bool BookingLog::open(const string &filename)
+{
+    fd = ::open(filename.c_str(), O_RDWR | O_APPEND | O_CREAT, 0644);
+    if (fd == -1)
+    {
+        logger.log(LOG_ERROR, string("❌ [WAL] open: ") + strerror(errno));
+        return false;
+    }
+    if (!repairTail())
+        return false;
+    writer = thread(&BookingLog::run, this);
+    return true;
+}
+
+// A crash in the middle of a write can leave the last row cut short. No one
+// was told that booking succeeded, so the torn line is dropped.
+bool BookingLog::repairTail()
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        logger.log(LOG_ERROR, string("❌ [WAL] fstat: ") + strerror(errno));
+        return false;
+    }
+    off_t end = st.st_size;
+    char chunk[4096];
+    while (end > 0)
+    {
+        off_t start = max<off_t>(0, end - (off_t)sizeof(chunk));
+        ssize_t n = pread(fd, chunk, end - start, start);
+        if (n != end - start)
+        {
+            logger.log(LOG_ERROR, string("❌ [WAL] pread: ") + strerror(errno));
+            return false;
+        }
+        const char *newline = (const char *)memrchr(chunk, '\n', n);
+        if (newline)
+        {
+            end = start + (newline - chunk) + 1;
+            break;
+        }
+        end = start;
+    }
+
+    if (end < st.st_size)
+    {
+        if (ftruncate(fd, end) != 0 || fdatasync(fd) != 0)
+        {
+            logger.log(LOG_ERROR, string("❌ [WAL] ftruncate: ") + strerror(errno));
+            return false;
+        }
+        logger.log(LOG_WARN, "🩹 Dropped " + to_string(st.st_size - end) + " bytes of a torn booking write");
+    }
+    durableSize = end;
+    return true;
+}
+
+future<bool> BookingLog::commit(const vector<string> &row)
+{
+    return commit(vector<vector<string>>{row});
+}
+
+future<bool> BookingLog::commit(const vector<vector<string>> &rows)
+{
+    auto saved = make_shared<promise<bool>>();
+    future<bool> result = saved->get_future();
+    commit(rows, [saved](bool ok) { saved->set_value(ok); });
+    return result;
+}
+
+// The rows travel as one contiguous block of the batch buffer, so a
+// multi-seat booking is written and synced together or not at all. done runs
+// on the writer thread and must not block it.
+void BookingLog::commit(const vector<vector<string>> &rows, function<void(bool)> done)
+{
+    PendingCommit c;
+    for (auto &row : rows)
+        c.lines += toCSVLine(row);
+    c.done = move(done);
+
+    {
+        auto lk = lockTimed(queueLock, METRIC_WAIT_BOOKING_LOG);
+        pending.push_back(move(c));
+    }
+    queueReady.notify_one();
+}
+
+bool BookingLog::writeAll(const string &data)
+{
+    size_t off = 0;
+    while (off < data.size())
+    {
+        ssize_t n = write(fd, data.data() + off, data.size() - off);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            logger.log(LOG_ERROR, string("❌ [WAL] write: ") + strerror(errno));
+            return false;
+        }
+        off += n;
+    }
+    return true;
+}
+
+void BookingLog::run()
+{
+    vector<PendingCommit> batch;
+    string buffer;
+
+    while (true)
+    {
+        {
+            unique_lock<mutex> lk(queueLock);
+            queueReady.wait(lk, [this] { return stopping || !pending.empty(); });
+            if (pending.empty() && stopping)
+                return;
+            batch.swap(pending);
+        }
+
+        buffer.clear();
+        for (auto &c : batch)
+            buffer += c.lines;
+
+        bool ok = writeAll(buffer);
+        if (ok)
+        {
+            MetricTimer timer(METRIC_FSYNC_BOOKINGS);
+            Span span("fdatasync bookings");
+            ok = fdatasync(fd) == 0;
+        }
+        // Every caller in the batch is told it failed, so none of it may stay
+        // in the file for the next start to read back as bookings
+        if (ok)
+            durableSize += buffer.size();
+        else if (ftruncate(fd, durableSize) != 0)
+            logger.log(LOG_ERROR, string("❌ [WAL] could not cut back a failed write: ") + strerror(errno));
+        for (auto &c : batch)
+            c.done(ok);
+        batch.clear();
+    }
+}
+
+void BookingLog::close()
+{
+    {
+        lock_guard<mutex> lk(queueLock);
+        stopping = true;
+    }
+    queueReady.notify_one();
+    if (writer.joinable())
+        writer.join();
+    if (fd != -1)
+        ::close(fd);
+    fd = -1;
+}
+
+BookingLog bookingLog;
+
+// --- BOOKINGS INDEX ---
+
+// One row of bookings.txt: TripID,BusNo,SeatNo,Aadhar,Name,Price,BookingTime
+struct Booking
+{
+    string tripId, busNo, seatNo, aadhar, name, price, bookedAt;
+
+    vector<string> toRow() const
+    {
+        return {tripId, busNo, seatNo, aadhar, name, price, bookedAt};
+    }
+};
+
+// Passenger Aadhar -> their bookings, built from bookings.txt at startup and
+// extended after every durable commit, so a passenger's ticket view costs
+// O(their tickets) no matter how many bookings exist overall.
+class BookingIndex
+{
+    mutable shared_mutex lock;
+    unordered_map<string, vector<Booking>> byPassenger;
+
+public:
+    void load(const string &filename);
+    void add(const Booking &b);
+    vector<Booking> forPassenger(const string &aadhar) const;
+    void forEach(const function<void(const Booking &)> &visit) const;
+};
+
+void BookingIndex::load(const string &filename)
+{
+    CsvFile file;
+    file.load(filename);
+
+    unique_lock<shared_mutex> w(lock);
+    byPassenger.clear();
+    size_t count = 0;
+    for (auto b : file)
+    {
+        if (b.size() < 7)
+            continue;
+        byPassenger[string(b[3])].push_back({string(b[0]), string(b[1]), string(b[2]), string(b[3]),
+                                             string(b[4]), string(b[5]), string(b[6])});
+        ++count;
+    }
+    cout << "🎫 Indexed " << count << " bookings for " << byPassenger.size() << " passengers" << endl;
+}
+
+void BookingIndex::add(const Booking &b)
+{
+    unique_lock<shared_mutex> w(lock);
+    byPassenger[b.aadhar].push_back(b);
+}
+
+vector<Booking> BookingIndex::forPassenger(const string &aadhar) const
+{
+    shared_lock<shared_mutex> r(lock);
+    auto it = byPassenger.find(aadhar);
+    return it == byPassenger.end() ? vector<Booking>() : it->second;
+}
+
+void BookingIndex::forEach(const function<void(const Booking &)> &visit) const
+{
+    shared_lock<shared_mutex> r(lock);
+    for (auto &passenger : byPassenger)
+        for (auto &b : passenger.second)
+            visit(b);
+}
+
+BookingIndex bookingIndex;
+
+// --- IDENTITY CACHE ---
+
+// users.txt and drivers.txt held in memory, keyed by Aadhar and by license,
+// so existence and credential checks are O(1) lookups with no file I/O.
+// Registrations go through here, which appends to the file and updates the
+// maps under one lock, so a duplicate can never slip in between check and write.
+class IdentityStore
+{
+    struct UserRecord
+    {
+        string name, age, passwordHash;
+    };
+    struct DriverRecord
+    {
+        string license, name, age, passwordHash;
+    };
+
+    mutable ProfiledMutex<shared_mutex> lock{"identities"};
+    unordered_map<string, UserRecord> users;          // Aadhar -> user
+    unordered_map<string, DriverRecord> drivers;      // Aadhar -> driver
+    unordered_map<string, string> driverByLicense;    // License -> Aadhar
+    unordered_set<string> pendingUsers, pendingDrivers, pendingLicenses;   // claimed, row still being written
+
+public:
+    void load(const string &userFile, const string &driverFile);
+
+    bool userExists(const string &aadhar) const;
+    bool licenseExists(const string &license) const;
+    bool checkUserPassword(const string &aadhar, const string &passwordHash) const;
+    bool checkDriverPassword(const string &aadhar, const string &passwordHash) const;
+    bool isRegisteredPassenger(const string &aadhar, const string &name) const;
+
+    bool addUser(const string &aadhar, const string &name, const string &age, const string &passwordHash);
+    bool addDriver(const string &aadhar, const string &license, const string &name,
+                   const string &age, const string &passwordHash);
+};
+
+void IdentityStore::load(const string &userFile, const string &driverFile)
+{
+    auto trimmed = [](string_view v) {
+        size_t start = v.find_first_not_of(" \t\n\r");
+        size_t end = v.find_last_not_of(" \t\n\r");
+        return start == string_view::npos ? string() : string(v.substr(start, end - start + 1));
+    };
+
+    CsvFile userCsv, driverCsv;
+    userCsv.load(userFile);
+    driverCsv.load(driverFile);
+
+    auto w = lockTimed(lock, METRIC_WAIT_IDENTITIES);
+    users.clear();
+    drivers.clear();
+    driverByLicense.clear();
+
+    for (auto row : userCsv)
+        if (row.size() >= 4)
+            users[string(row[0])] = {string(row[1]), string(row[2]), string(row[3])};
+
+    for (auto row : driverCsv)
+    {
+        if (row.size() >= 2)
+            driverByLicense[string(row[1])] = trimmed(row[0]);
+        if (row.size() >= 5)
+            drivers[trimmed(row[0])] = {string(row[1]), string(row[2]), string(row[3]), trimmed(row[4])};
+    }
+    cout << "🪪 Loaded " << users.size() << " users and " << drivers.size() << " drivers" << endl;
+}
+
+bool IdentityStore::userExists(const string &aadhar) const
+{
+    shared_lock r(lock);
+    return users.count(aadhar) > 0;
+}
+
+bool IdentityStore::licenseExists(const string &license) const
+{
+    shared_lock r(lock);
+    return driverByLicense.count(license) > 0;
+}
+
+bool IdentityStore::checkUserPassword(const string &aadhar, const string &passwordHash) const
+{
+    shared_lock r(lock);
+    auto it = users.find(aadhar);
+    return it != users.end() && it->second.passwordHash == passwordHash;
+}
+
+bool IdentityStore::checkDriverPassword(const string &aadhar, const string &passwordHash) const
+{
+    shared_lock r(lock);
+    auto it = drivers.find(aadhar);
+    return it != drivers.end() && it->second.passwordHash == passwordHash;
+}
+
+// Passenger details typed at booking time must match a registered user
+bool IdentityStore::isRegisteredPassenger(const string &aadhar, const string &name) const
+{
+    shared_lock r(lock);
+    auto it = users.find(aadhar);
+    return it != users.end() && equalsIgnoreCase(it->second.name, name);
+}
+
+// The Aadhar is claimed under the lock, but the row is written and synced
+// outside it, so logins and lookups never wait behind a disk flush. The
+// claim keeps a second registration of the same Aadhar out meanwhile. Each
+// row goes out in one O_APPEND write, so concurrent appends do not mix.
+bool IdentityStore::addUser(const string &aadhar, const string &name, const string &age, const string &passwordHash)
+{
+    {
+        auto w = lockTimed(lock, METRIC_WAIT_IDENTITIES);
+        if (users.count(aadhar) || !pendingUsers.insert(aadhar).second)
+            return false;
+    }
+
+    writeFile(USER_FILE, {aadhar, name, age, passwordHash});
+
+    auto w = lockTimed(lock, METRIC_WAIT_IDENTITIES);
+    pendingUsers.erase(aadhar);
+    users[aadhar] = {name, age, passwordHash};
+    return true;
+}
+
+bool IdentityStore::addDriver(const string &aadhar, const string &license, const string &name,
+                              const string &age, const string &passwordHash)
+{
+    {
+        auto w = lockTimed(lock, METRIC_WAIT_IDENTITIES);
+        if (drivers.count(aadhar) || driverByLicense.count(license) ||
+            pendingDrivers.count(aadhar) || pendingLicenses.count(license))
+            return false;
+        pendingDrivers.insert(aadhar);
+        pendingLicenses.insert(license);
+    }
+
+    writeFile(DRIVER_FILE, {aadhar, license, name, age, passwordHash});
+
+    auto w = lockTimed(lock, METRIC_WAIT_IDENTITIES);
+    pendingDrivers.erase(aadhar);
+    pendingLicenses.erase(license);
+    drivers[aadhar] = {license, name, age, passwordHash};
+    driverByLicense[license] = aadhar;
+    return true;
+}
+
+IdentityStore identities;
+
+// --- TRIP CATALOG ---
+
+// One row of trips.txt: TripID,BusNo,Source,Destination,Distance,DriverAadhar,Departure
+struct Trip
+{
+    string id, busNo, source, destination, distance, driverAadhar, departure;
+    time_t departsAt = -1;   // departure parsed once when the trip is indexed
+
+    vector<string> toRow() const
+    {
+        return {id, busNo, source, destination, distance, driverAadhar, departure};
+    }
+};
+
+// A trip that has not left yet, as shown in the "Upcoming Trips" list
+struct UpcomingTrip
+{
+    Trip trip;
+    bool discount;   // leaves within the hour: 10% off
+};
+
+// Trips leaving within the hour are sold at a discount
+bool lastHourDiscount(time_t departsAt, time_t now)
+{
+    int timeDiffMinutes = difftime(departsAt, now) / 60;
+    return timeDiffMinutes <= 60 && timeDiffMinutes > 0;
+}
+
+// Resident copy of trips.txt, loaded once at startup and kept in step with
+// every insert, so lookups never have to re-read the file.
+//
+// Trips that have not departed yet are also kept ordered by departure time.
+// Each refresh pops the trips that have left since the last one off the
+// front, so a trip is expired exactly once and a refresh costs O(trips shown).
+// The trips leaving within the hour are the front of that order.
+class TripStore
+{
+    mutable ProfiledMutex<shared_mutex> lock{"trips"};
+    vector<Trip> trips;                              // in file order
+    unordered_map<string, size_t> byId;              // TripID -> index
+    unordered_multimap<string, size_t> byBus;        // BusNo -> index
+    unordered_multimap<string, size_t> byDriver;     // Driver Aadhar -> index
+    int maxSeq = 0;                                  // highest numeric part of "Txxx"; changed only under appendLock
+    ProfiledMutex<mutex> appendLock{"trip_append"};  // orders inserts: IDs and rows in trips.txt; taken before `lock`
+
+    mutex departuresLock;                            // taken inside `lock`
+    set<pair<time_t, size_t>> departures;            // not yet departed, soonest first
+
+    void index(Trip t);
+
+public:
+    void load(const string &filename);
+    bool find(const string &tripId, Trip &out) const;
+    vector<Trip> tripsForBus(const string &busNo) const;
+    vector<Trip> tripsForDriver(const string &aadhar) const;
+    vector<Trip> all() const;
+    vector<UpcomingTrip> upcoming(time_t now);
+    // beforeSaving sees the trips with their new IDs before any row is
+    // written; if it fails, nothing is saved and "" / {} is returned
+    using BeforeSaving = function<bool(const vector<Trip> &)>;
+    string insert(Trip t, const BeforeSaving &beforeSaving = nullptr);
+    vector<string> insertMany(vector<Trip> batch, const BeforeSaving &beforeSaving = nullptr);
+};
+
+void TripStore::index(Trip t)
+{
+    if (t.departsAt == -1)
+        t.departsAt = getTimeFromDateTime(t.departure);
+
+    size_t pos = trips.size();
+    trips.push_back(t);
+    byId[t.id] = pos;
+    byBus.emplace(t.busNo, pos);
+    byDriver.emplace(t.driverAadhar, pos);
+
+    if (t.departsAt > time(nullptr))
+    {
+        lock_guard<mutex> lk(departuresLock);
+        departures.emplace(t.departsAt, pos);
+    }
+
+    if (t.id.size() > 1 && t.id[0] == 'T' &&
+        all_of(t.id.begin() + 1, t.id.end(), ::isdigit))
+        maxSeq = max(maxSeq, stoi(t.id.substr(1)));
+}
+
+void TripStore::load(const string &filename)
+{
+    auto w = lockTimed(lock, METRIC_WAIT_TRIPS);
+    trips.clear();
+    byId.clear();
+    byBus.clear();
+    byDriver.clear();
+    maxSeq = 0;
+    {
+        lock_guard<mutex> lk(departuresLock);
+        departures.clear();
+    }
+
+    CsvFile file;
+    file.load(filename);
+    for (auto row : file)
+    {
+        if (row.size() != 7)
+            continue;
+        index({string(row[0]), string(row[1]), string(row[2]), string(row[3]),
+               string(row[4]), string(row[5]), string(row[6])});
+    }
+    cout << "📚 Loaded " << trips.size() << " trips from " << filename << endl;
+}
+
+bool TripStore::find(const string &tripId, Trip &out) const
+{
+    shared_lock r(lock);
+    auto it = byId.find(tripId);
+    if (it == byId.end())
+        return false;
+    out = trips[it->second];
+    return true;
+}
+
+vector<Trip> TripStore::tripsForBus(const string &busNo) const
+{
+    shared_lock r(lock);
+    vector<Trip> result;
+    auto range = byBus.equal_range(busNo);
+    for (auto it = range.first; it != range.second; ++it)
+        result.push_back(trips[it->second]);
+    return result;
+}
+
+vector<Trip> TripStore::tripsForDriver(const string &aadhar) const
+{
+    shared_lock r(lock);
+    vector<Trip> result;
+    auto range = byDriver.equal_range(aadhar);
+    for (auto it = range.first; it != range.second; ++it)
+        result.push_back(trips[it->second]);
+    return result;
+}
+
+vector<Trip> TripStore::all() const
+{
+    shared_lock r(lock);
+    return trips;
+}
+
+vector<UpcomingTrip> TripStore::upcoming(time_t now)
+{
+    Span span("TripStore::upcoming");
+    shared_lock r(lock);
+    lock_guard<mutex> lk(departuresLock);
+
+    // Expire everything that has left since the last refresh
+    while (!departures.empty() && departures.begin()->first <= now)
+        departures.erase(departures.begin());
+
+    vector<UpcomingTrip> result;
+    result.reserve(departures.size());
+    for (auto &d : departures)
+    {
+        result.push_back({trips[d.second], lastHourDiscount(d.first, now)});
+    }
+    return result;
+}
+
+// Assigns the next Trip ID, appends the row to trips.txt and indexes it
+string TripStore::insert(Trip t, const BeforeSaving &beforeSaving)
+{
+    vector<string> ids = insertMany({t}, beforeSaving);
+    return ids.empty() ? "" : ids.front();
+}
+
+// The whole batch goes to trips.txt in one write and one fsync, with
+// consecutive Trip IDs. Done under appendLock so two drivers can never be
+// handed the same ID. The catalog lock is only taken to index the trips, so
+// nobody browsing trips waits for the fsync.
+vector<string> TripStore::insertMany(vector<Trip> batch, const BeforeSaving &beforeSaving)
+{
+    auto a = lockTimed(appendLock, METRIC_WAIT_TRIP_APPEND);
+
+    vector<vector<string>> rows;
+    vector<string> ids;
+    int seq = maxSeq;
+    for (auto &t : batch)
+    {
+        stringstream ss;
+        ss << "T" << setfill('0') << setw(3) << ++seq;
+        t.id = ss.str();
+        ids.push_back(t.id);
+        rows.push_back(t.toRow());
+    }
+
+    // IDs that got as far as beforeSaving may already name seat layouts, so
+    // a failed insert still uses them up
+    if ((beforeSaving && !beforeSaving(batch)) || !writeRows(TRIPS_FILE, rows))
+    {
+        maxSeq = seq;
+        return {};
+    }
+    auto w = lockTimed(lock, METRIC_WAIT_TRIPS);
+    for (auto &t : batch)
+        index(t);
+    return ids;
+}
+
+TripStore tripStore;
+
+// --- SEAT STORE ---
+
+// All seat layouts live in one memory-mapped file of fixed-width records,
+// one per trip, instead of a seat<TripId>.txt CSV per trip.
+const string SEAT_FILE = "seats.bin";
+const int MAX_SEATS = 128;
+
+// Price classes, in the order seatLayoutFor assigns them
+enum SeatClass
+{
+    WINDOW_SEAT = 0,
+    MIDDLE_SEAT = 1,
+    BACK_WINDOW_SEAT = 2,
+    BACK_MIDDLE_SEAT = 3
+};
+
+int seatClassOf(int seatIndex, int rows, int cols)
+{
+    int r = seatIndex / cols;
+    int c = seatIndex % cols;
+    bool window = (c == 0 || c == cols - 1);
+    if (r == rows - 1)
+        return window ? BACK_WINDOW_SEAT : BACK_MIDDLE_SEAT;
+    return window ? WINDOW_SEAT : MIDDLE_SEAT;
+}
+
+// On-disk layout: one 64-byte header followed by 64-byte trip records.
+struct SeatFileHeader
+{
+    char magic[8];          // "BRSEAT1"
+    uint32_t recordSize;
+    uint32_t count;         // records in use
+    char reserved[48];
+};
+
+struct SeatRecord
+{
+    char tripId[16];
+    uint64_t booked[MAX_SEATS / 64];    // bit (n-1) set => seat n booked
+    uint32_t classPrice[4];             // indexed by SeatClass
+    uint16_t rows, cols;
+    uint32_t version;                   // bumped by every change to booked
+    char reserved[8];
+};
+
+static_assert(sizeof(SeatFileHeader) == 64, "seat file header must stay 64 bytes");
+static_assert(sizeof(SeatRecord) == 64, "seat record must stay 64 bytes");
+
+// A copy of one trip's seat record, safe to use without holding any lock
+struct SeatSnapshot
+{
+    int rows = 0, cols = 0;
+    uint32_t classPrice[4] = {0, 0, 0, 0};
+    uint64_t booked[MAX_SEATS / 64] = {0, 0};
+
+    int seatCount() const { return rows * cols; }
+    bool isValidSeat(int seatNo) const { return seatNo >= 1 && seatNo <= seatCount(); }
+    bool isBooked(int seatNo) const
+    {
+        return (booked[(seatNo - 1) / 64] >> ((seatNo - 1) % 64)) & 1;
+    }
+    int price(int seatNo) const { return classPrice[seatClassOf(seatNo - 1, rows, cols)]; }
+};
+
+// Everything needed to add one trip to the seat store
+struct SeatLayout
+{
+    string tripId;
+    int rows = 0, cols = 0;
+    uint32_t classPrice[4] = {0, 0, 0, 0};
+    uint64_t booked[MAX_SEATS / 64] = {0, 0};
+};
+
+// Seat claims never take a global lock. The file is mapped once into a
+// reservation big enough for MAX_TRIP_RECORDS, so record addresses never move
+// and growing the store is just an ftruncate. TripID -> slot lookups go
+// through SLOT_STRIPES independently locked shards, and the booked bitset is
+// updated with atomic read-modify-write, so bookings on different trips run
+// fully in parallel and two clients racing for one seat get exactly one winner.
+const uint32_t MAX_TRIP_RECORDS = 1u << 24;
+const int SLOT_STRIPES = 64;
+
+class SeatStore
+{
+    struct SlotStripe
+    {
+        shared_mutex lock;
+        unordered_map<string, uint32_t> slots;   // TripID -> record index
+    };
+
+    ProfiledMutex<mutex> appendLock{"seat_append"};   // serialises create() only
+    int fd = -1;
+    char *base = nullptr;
+    size_t fileSize = 0;
+    SlotStripe stripes[SLOT_STRIPES];
+
+    SeatFileHeader *header() { return reinterpret_cast<SeatFileHeader *>(base); }
+    SeatRecord *record(uint32_t slot)
+    {
+        return reinterpret_cast<SeatRecord *>(base + sizeof(SeatFileHeader)) + slot;
+    }
+    SlotStripe &stripeFor(const string &tripId)
+    {
+        return stripes[hash<string>()(tripId) % SLOT_STRIPES];
+    }
+    void syncRange(const void *addr, size_t len);
+    SeatRecord *find(const string &tripId);
+    static bool readLegacy(SeatLayout &l);
+
+public:
+    bool open(const string &filename);
+    bool has(const string &tripId) { return find(tripId) != nullptr; }
+    bool create(const string &tripId, int rows, int cols, const uint32_t classPrice[4]);
+    bool createMany(const vector<SeatLayout> &layouts);
+    bool snapshot(const string &tripId, SeatSnapshot &out);
+    uint32_t version(const string &tripId);
+    bool book(const string &tripId, int seatNo);
+    bool bookMany(const string &tripId, const vector<int> &seatNos, int &takenSeat);
+    void release(const string &tripId, const vector<int> &seatNos);
+    void importLegacy(const vector<Trip> &trips);
+    void reconcile(const BookingIndex &tickets);
+};
+
+// msync wants a page-aligned start address
+void SeatStore::syncRange(const void *addr, size_t len)
+{
+    static const uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+    uintptr_t start = reinterpret_cast<uintptr_t>(addr) & ~(pageSize - 1);
+    uintptr_t end = reinterpret_cast<uintptr_t>(addr) + len;
+    MetricTimer timer(METRIC_FSYNC_SEATS);
+    msync(reinterpret_cast<void *>(start), end - start, MS_SYNC);
+}
+
+bool SeatStore::open(const string &filename)
+{
+    fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd == -1)
+    {
+        logger.log(LOG_ERROR, string("❌ [SEATS] open: ") + strerror(errno));
+        return false;
+    }
+
+    struct stat st;
+    fstat(fd, &st);
+    bool fresh = st.st_size < (off_t)sizeof(SeatFileHeader);
+    fileSize = fresh ? sizeof(SeatFileHeader) + 1024 * sizeof(SeatRecord) : st.st_size;
+    if (fresh && ftruncate(fd, fileSize) != 0)
+    {
+        logger.log(LOG_ERROR, string("❌ [SEATS] ftruncate: ") + strerror(errno));
+        return false;
+    }
+
+    // Only the first fileSize bytes are backed; the rest of the reservation
+    // is never touched until ftruncate has grown the file over it.
+    size_t reserved = sizeof(SeatFileHeader) + (size_t)MAX_TRIP_RECORDS * sizeof(SeatRecord);
+    void *p = mmap(nullptr, reserved, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+    {
+        logger.log(LOG_ERROR, string("❌ [SEATS] mmap: ") + strerror(errno));
+        return false;
+    }
+    base = static_cast<char *>(p);
+
+    if (fresh)
+    {
+        strcpy(header()->magic, "BRSEAT1");
+        header()->recordSize = sizeof(SeatRecord);
+        header()->count = 0;
+        syncRange(base, sizeof(SeatFileHeader));
+    }
+    else if (strcmp(header()->magic, "BRSEAT1") != 0 || header()->recordSize != sizeof(SeatRecord))
+    {
+        logger.log(LOG_ERROR, "❌ " + filename + " is not a seat file of this version");
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header()->count; ++i)
+    {
+        string id(record(i)->tripId, strnlen(record(i)->tripId, sizeof(record(i)->tripId)));
+        stripeFor(id).slots[id] = i;
+    }
+
+    cout << "💺 Loaded seat layouts for " << header()->count << " trips from " << filename << endl;
+    return true;
+}
+
+SeatRecord *SeatStore::find(const string &tripId)
+{
+    SlotStripe &stripe = stripeFor(tripId);
+    shared_lock<shared_mutex> r(stripe.lock);
+    auto it = stripe.slots.find(tripId);
+    return it == stripe.slots.end() ? nullptr : record(it->second);
+}
+
+bool SeatStore::create(const string &tripId, int rows, int cols, const uint32_t classPrice[4])
+{
+    SeatLayout layout;
+    layout.tripId = tripId;
+    layout.rows = rows;
+    layout.cols = cols;
+    memcpy(layout.classPrice, classPrice, sizeof(layout.classPrice));
+    return createMany({layout});
+}
+
+// Builds every record in memory, copies them into consecutive slots and
+// persists the whole run with one msync plus one for the header. Either all
+// layouts are added or none are.
+bool SeatStore::createMany(const vector<SeatLayout> &layouts)
+{
+    vector<SeatRecord> recs(layouts.size());
+    for (size_t i = 0; i < layouts.size(); ++i)
+    {
+        const SeatLayout &l = layouts[i];
+        if (l.rows <= 0 || l.cols <= 0 || l.rows * l.cols > MAX_SEATS ||
+            l.tripId.empty() || l.tripId.size() >= sizeof(SeatRecord::tripId))
+            return false;
+
+        SeatRecord &rec = recs[i];
+        memset(&rec, 0, sizeof(rec));
+        strncpy(rec.tripId, l.tripId.c_str(), sizeof(rec.tripId) - 1);
+        rec.rows = l.rows;
+        rec.cols = l.cols;
+        memcpy(rec.classPrice, l.classPrice, sizeof(rec.classPrice));
+        memcpy(rec.booked, l.booked, sizeof(rec.booked));
+    }
+    if (recs.empty())
+        return true;
+
+    auto lk = lockTimed(appendLock, METRIC_WAIT_SEAT_APPEND);
+    unordered_set<string> seen;
+    for (auto &l : layouts)
+        if (find(l.tripId) || !seen.insert(l.tripId).second)
+            return false;
+
+    uint32_t first = header()->count;
+    if (recs.size() > MAX_TRIP_RECORDS - first)
+        return false;
+    size_t needed = sizeof(SeatFileHeader) + (first + recs.size()) * sizeof(SeatRecord);
+    if (needed > fileSize)
+    {
+        size_t grown = max(needed, fileSize * 2);
+        if (ftruncate(fd, grown) != 0)
+        {
+            logger.log(LOG_ERROR, string("❌ [SEATS] could not grow the seat file: ") + strerror(errno));
+            return false;
+        }
+        fileSize = grown;
+    }
+
+    // The slots are not published yet, so nobody else can be looking at them
+    memcpy(record(first), recs.data(), recs.size() * sizeof(SeatRecord));
+    syncRange(record(first), recs.size() * sizeof(SeatRecord));
+    header()->count = first + recs.size();
+    syncRange(base, sizeof(SeatFileHeader));
+
+    for (size_t i = 0; i < layouts.size(); ++i)
+    {
+        SlotStripe &stripe = stripeFor(layouts[i].tripId);
+        unique_lock<shared_mutex> w(stripe.lock);
+        stripe.slots[layouts[i].tripId] = first + i;
+    }
+    return true;
+}
+
+bool SeatStore::snapshot(const string &tripId, SeatSnapshot &out)
+{
+    SeatRecord *rec = find(tripId);
+    if (!rec)
+        return false;
+
+    out.rows = rec->rows;
+    out.cols = rec->cols;
+    memcpy(out.classPrice, rec->classPrice, sizeof(out.classPrice));
+    for (int w = 0; w < MAX_SEATS / 64; ++w)
+        out.booked[w] = __atomic_load_n(&rec->booked[w], __ATOMIC_ACQUIRE);
+    return true;
+}
+
+uint32_t SeatStore::version(const string &tripId)
+{
+    SeatRecord *rec = find(tripId);
+    return rec ? __atomic_load_n(&rec->version, __ATOMIC_ACQUIRE) : 0;
+}
+
+// Claims one seat with an atomic fetch-or on its bitset word; whoever sees
+// the bit clear beforehand is the single winner. Persists the page it lives on.
+bool SeatStore::book(const string &tripId, int seatNo)
+{
+    SeatRecord *rec = find(tripId);
+    if (!rec || seatNo < 1 || seatNo > rec->rows * rec->cols)
+        return false;
+
+    uint64_t *word = &rec->booked[(seatNo - 1) / 64];
+    uint64_t bit = 1ULL << ((seatNo - 1) % 64);
+    if (__atomic_fetch_or(word, bit, __ATOMIC_ACQ_REL) & bit)
+        return false;   // somebody else got there first
+    __atomic_add_fetch(&rec->version, 1, __ATOMIC_RELEASE);
+    syncRange(word, sizeof(*word));
+    return true;
+}
+
+// All-or-nothing claim of several seats on one trip. Seats are claimed one
+// by one like book(); if any is already taken the ones we got are released
+// again and takenSeat names the culprit. The bitset of one trip sits in a
+// single record, so one msync persists the whole group.
+bool SeatStore::bookMany(const string &tripId, const vector<int> &seatNos, int &takenSeat)
+{
+    Span span("SeatStore::bookMany");
+    takenSeat = 0;
+    SeatRecord *rec = find(tripId);
+    if (!rec || seatNos.empty())
+        return false;
+    for (int seatNo : seatNos)
+        if (seatNo < 1 || seatNo > rec->rows * rec->cols)
+        {
+            takenSeat = seatNo;
+            return false;
+        }
+
+    auto bitOf = [](int seatNo) { return 1ULL << ((seatNo - 1) % 64); };
+    auto wordOf = [rec](int seatNo) { return &rec->booked[(seatNo - 1) / 64]; };
+
+    size_t claimed = 0;
+    for (; claimed < seatNos.size(); ++claimed)
+    {
+        int seatNo = seatNos[claimed];
+        if (__atomic_fetch_or(wordOf(seatNo), bitOf(seatNo), __ATOMIC_ACQ_REL) & bitOf(seatNo))
+            break;
+    }
+
+    if (claimed < seatNos.size())
+    {
+        takenSeat = seatNos[claimed];
+        for (size_t i = 0; i < claimed; ++i)
+            __atomic_fetch_and(wordOf(seatNos[i]), ~bitOf(seatNos[i]), __ATOMIC_ACQ_REL);
+        // Readers may have seen the seats we gave back
+        if (claimed > 0)
+            __atomic_add_fetch(&rec->version, 1, __ATOMIC_RELEASE);
+        return false;
+    }
+    __atomic_add_fetch(&rec->version, 1, __ATOMIC_RELEASE);
+    syncRange(rec->booked, sizeof(rec->booked));
+    return true;
+}
+
+// Gives back seats claimed by bookMany() whose booking could not be saved
+void SeatStore::release(const string &tripId, const vector<int> &seatNos)
+{
+    SeatRecord *rec = find(tripId);
+    if (!rec)
+        return;
+    for (int seatNo : seatNos)
+        if (seatNo >= 1 && seatNo <= rec->rows * rec->cols)
+            __atomic_fetch_and(&rec->booked[(seatNo - 1) / 64], ~(1ULL << ((seatNo - 1) % 64)), __ATOMIC_ACQ_REL);
+    __atomic_add_fetch(&rec->version, 1, __ATOMIC_RELEASE);
+    syncRange(rec->booked, sizeof(rec->booked));
+}
+
+// bookings.txt is the record of who holds which seat. A seat is claimed
+// here (and synced) before its row reaches the log, so a crash or a failed
+// commit in between leaves a claimed seat nobody has a ticket for; a crash
+// after the log but before the msync leaves the opposite. At startup every
+// trip's booked bits are set to exactly the seats that have a ticket.
+//
+// Seats sold before bookings.txt existed have no row: for a trip imported by
+// importLegacy, what its seat<TripId>.txt says is booked counts as ticketed.
+// The file is only read for a trip whose bits disagree with the log.
+void SeatStore::reconcile(const BookingIndex &tickets)
+{
+    using SeatBits = array<uint64_t, MAX_SEATS / 64>;
+    unordered_map<string, SeatBits> ticketed;   // TripID -> seats with a ticket
+    tickets.forEach([&ticketed](const Booking &b) {
+        int seatNo;
+        if (parseInt(b.seatNo, seatNo) && seatNo >= 1 && seatNo <= MAX_SEATS)
+            ticketed[b.tripId][(seatNo - 1) / 64] |= 1ULL << ((seatNo - 1) % 64);
+    });
+
+    size_t repaired = 0;
+    for (uint32_t i = 0; i < header()->count; ++i)
+    {
+        SeatRecord *rec = record(i);
+        string tripId(rec->tripId, strnlen(rec->tripId, sizeof(rec->tripId)));
+        SeatBits booked = {};
+        auto it = ticketed.find(tripId);
+        if (it != ticketed.end())
+            booked = it->second;
+        for (int seatNo = rec->rows * rec->cols + 1; seatNo <= MAX_SEATS; ++seatNo)
+            booked[(seatNo - 1) / 64] &= ~(1ULL << ((seatNo - 1) % 64));
+
+        if (memcmp(booked.data(), rec->booked, sizeof(rec->booked)) != 0)
+        {
+            SeatLayout legacy;
+            legacy.tripId = tripId;
+            legacy.rows = rec->rows;
+            legacy.cols = rec->cols;
+            if (readLegacy(legacy))
+                for (size_t w = 0; w < booked.size(); ++w)
+                    booked[w] |= legacy.booked[w];
+        }
+
+        if (memcmp(booked.data(), rec->booked, sizeof(rec->booked)) != 0)
+        {
+            memcpy(rec->booked, booked.data(), sizeof(rec->booked));
+            ++rec->version;
+            ++repaired;
+        }
+    }
+    if (repaired)
+    {
+        syncRange(record(0), header()->count * sizeof(SeatRecord));
+        logger.log(LOG_WARN, "🩹 Matched the seats of " + to_string(repaired) + " trips to their tickets in " + BOOKING_FILE);
+    }
+}
+
+// Fills in l's prices and booked seats from seat<TripId>.txt, given its
+// tripId, rows and cols; false if the trip has no such file
+bool SeatStore::readLegacy(SeatLayout &l)
+{
+    CsvFile seatData;
+    if (l.rows * l.cols > MAX_SEATS || !seatData.load("seat" + l.tripId + ".txt") || seatData.size() == 0)
+        return false;
+    for (int i = 0; i < l.rows * l.cols && i < (int)seatData.size(); ++i)
+    {
+        auto seat = seatData[i];
+        int seatNo, price;
+        if (seat.size() < 3 || !parseInt(seat[0], seatNo) || !parseInt(seat[2], price))
+            continue;
+        l.classPrice[seatClassOf(i, l.rows, l.cols)] = price;
+        if (seat[1] == "1" && seatNo >= 1 && seatNo <= l.rows * l.cols)
+            l.booked[(seatNo - 1) / 64] |= 1ULL << ((seatNo - 1) % 64);
+    }
+    return true;
+}
+
+// One-off migration: trips created before seats.bin existed still have a
+// seat<TripId>.txt file. Pull those into the store the first time we start.
+void SeatStore::importLegacy(const vector<Trip> &trips)
+{
+    unordered_map<string, pair<int, int>> layouts = loadBusLayouts();
+
+    vector<SeatLayout> imported;
+    for (auto &trip : trips)
+    {
+        if (has(trip.id) || !layouts.count(trip.busNo))
+            continue;
+
+        SeatLayout l;
+        l.tripId = trip.id;
+        l.rows = layouts[trip.busNo].first;
+        l.cols = layouts[trip.busNo].second;
+        if (readLegacy(l))
+            imported.push_back(l);
+    }
+    if (!imported.empty() && createMany(imported))
+        cout << "💺 Imported " << imported.size() << " legacy seat files into " << SEAT_FILE << endl;
+}
+
+SeatStore seatStore;
+
+// --- SEAT HOLDS ---
+
+// A seat chosen in reserve() is held for HOLD_SECONDS while the passenger
+// types their details, so nobody can take it before they confirm. Holds live
+// in memory only; a restart simply forgets them.
+const uint64_t HOLD_SECONDS = 120;
+
+// Hierarchical timing wheel: WHEEL_LEVELS wheels of 64 one-tick, 64-tick,
+// 4096-tick... slots. A timer goes into the lowest level whose slot span
+// still covers its due tick, and drops a level each time the wheel turns
+// past it, so scheduling is O(1) and each timer is touched at most once
+// per level however many are pending.
+class TimerWheel
+{
+    static const int WHEEL_LEVELS = 4;
+    static const int SLOT_BITS = 6;
+    static const uint64_t SLOTS = 1 << SLOT_BITS;
+
+    struct Timer
+    {
+        uint64_t id, due;
+    };
+
+    vector<Timer> slots[WHEEL_LEVELS][SLOTS];
+    vector<Timer> overflow;     // due beyond the top level's span
+    uint64_t current = 0;       // last tick processed
+    size_t count = 0;
+
+    void place(Timer t);
+
+public:
+    void schedule(uint64_t id, uint64_t dueTick);
+    // Moves the wheel to tick, calling fire(id, due) for every timer that came due
+    template <typename Fire>
+    void advance(uint64_t tick, Fire fire);
+};
+
+void TimerWheel::place(Timer t)
+{
+    for (int level = 0; level < WHEEL_LEVELS; ++level)
+    {
+        int shift = SLOT_BITS * (level + 1);
+        // Same digits above this level: the slot comes round before anything higher turns
+        if ((t.due >> shift) == (current >> shift))
+        {
+            slots[level][(t.due >> (SLOT_BITS * level)) & (SLOTS - 1)].push_back(t);
+            return;
+        }
+    }
+    overflow.push_back(t);
+}
+
+void TimerWheel::schedule(uint64_t id, uint64_t dueTick)
+{
+    place({id, max(dueTick, current + 1)});
+    ++count;
+}
+
+template <typename Fire>
+void TimerWheel::advance(uint64_t tick, Fire fire)
+{
+    // Nothing pending: jump straight there instead of ticking through idle time
+    while (current < tick && count > 0)
+    {
+        ++current;
+
+        // Cascade every level whose lower digits just wrapped, top down
+        if ((current & ((1ULL << (SLOT_BITS * WHEEL_LEVELS)) - 1)) == 0)
+        {
+            vector<Timer> later;
+            later.swap(overflow);
+            for (auto &t : later)
+                place(t);
+        }
+        for (int level = WHEEL_LEVELS - 1; level > 0; --level)
+        {
+            if ((current & ((1ULL << (SLOT_BITS * level)) - 1)) != 0)
+                continue;
+            vector<Timer> cascading;
+            cascading.swap(slots[level][(current >> (SLOT_BITS * level)) & (SLOTS - 1)]);
+            for (auto &t : cascading)
+                place(t);
+        }
+
+        vector<Timer> due;
+        due.swap(slots[0][current & (SLOTS - 1)]);
+        count -= due.size();
+        for (auto &t : due)
+            fire(t.id, t.due);
+    }
+    current = max(current, tick);
+}
+
+class SeatHolds
+{
+    struct Hold
+    {
+        string tripId;
+        vector<int> seatNos;
+        uint64_t expiresAt;
+    };
+
+    ProfiledMutex<mutex> lock{"seat_holds"};
+    TimerWheel wheel;
+    unordered_map<uint64_t, Hold> holds;                          // hold ID -> hold
+    unordered_map<string, unordered_map<int, uint64_t>> bySeat;   // TripID -> seat -> hold ID
+    unordered_map<string, uint64_t> versions;                     // TripID -> changes to its holds
+    uint64_t nextId = 1;
+
+    static uint64_t nowTick();
+    void expireLocked();
+    void releaseLocked(uint64_t holdId);
+
+public:
+    bool hold(const string &tripId, const vector<int> &seatNos, uint64_t &holdId, int &takenSeat);
+    void release(uint64_t holdId);
+    vector<int> held(const string &tripId);
+    uint64_t version(const string &tripId);
+};
+
+uint64_t SeatHolds::nowTick()
+{
+    return chrono::duration_cast<chrono::seconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// The wheel is turned by whoever touches the holds next, so no timer thread
+void SeatHolds::expireLocked()
+{
+    wheel.advance(nowTick(), [this](uint64_t holdId, uint64_t due) {
+        auto it = holds.find(holdId);
+        // A renewed hold left its old timer behind; only the latest one counts
+        if (it != holds.end() && it->second.expiresAt == due)
+            releaseLocked(holdId);
+    });
+}
+
+void SeatHolds::releaseLocked(uint64_t holdId)
+{
+    auto it = holds.find(holdId);
+    if (it == holds.end())
+        return;
+    ++versions[it->second.tripId];
+    auto trip = bySeat.find(it->second.tripId);
+    for (int seatNo : it->second.seatNos)
+        trip->second.erase(seatNo);
+    if (trip->second.empty())
+        bySeat.erase(trip);
+    holds.erase(it);
+}
+
+// Holds seatNos for another HOLD_SECONDS. holdId 0 starts a new hold; an
+// existing holdId is renewed and now covers exactly seatNos. Fails with
+// takenSeat set if someone else holds one of them.
+bool SeatHolds::hold(const string &tripId, const vector<int> &seatNos, uint64_t &holdId, int &takenSeat)
+{
+    Span span("SeatHolds::hold");
+    auto guard = lockTimed(lock, METRIC_WAIT_SEAT_HOLDS);
+    expireLocked();
+
+    auto trip = bySeat.find(tripId);
+    if (trip != bySeat.end())
+        for (int seatNo : seatNos)
+        {
+            auto seat = trip->second.find(seatNo);
+            if (seat != trip->second.end() && seat->second != holdId)
+            {
+                takenSeat = seatNo;
+                return false;
+            }
+        }
+
+    releaseLocked(holdId);
+    if (holdId == 0)
+        holdId = nextId++;
+
+    uint64_t expiresAt = nowTick() + HOLD_SECONDS;
+    holds[holdId] = {tripId, seatNos, expiresAt};
+    ++versions[tripId];
+    auto &seats = bySeat[tripId];
+    for (int seatNo : seatNos)
+        seats[seatNo] = holdId;
+    wheel.schedule(holdId, expiresAt);
+    return true;
+}
+
+void SeatHolds::release(uint64_t holdId)
+{
+    auto guard = lockTimed(lock, METRIC_WAIT_SEAT_HOLDS);
+    releaseLocked(holdId);
+}
+
+vector<int> SeatHolds::held(const string &tripId)
+{
+    auto guard = lockTimed(lock, METRIC_WAIT_SEAT_HOLDS);
+    expireLocked();
+
+    vector<int> seatNos;
+    auto trip = bySeat.find(tripId);
+    if (trip != bySeat.end())
+        for (auto &seat : trip->second)
+            seatNos.push_back(seat.first);
+    return seatNos;
+}
+
+uint64_t SeatHolds::version(const string &tripId)
+{
+    auto guard = lockTimed(lock, METRIC_WAIT_SEAT_HOLDS);
+    expireLocked();
+    auto it = versions.find(tripId);
+    return it == versions.end() ? 0 : it->second;
+}
+
+SeatHolds seatHolds;
+
+// Releases its hold when it goes out of scope, including when a client
+// disconnects and its dialogue frame is destroyed mid-confirmation
+struct SeatHold
+{
+    uint64_t id = 0;
+
+    SeatHold() = default;
+    SeatHold(const SeatHold &) = delete;
+    SeatHold &operator=(const SeatHold &) = delete;
+    ~SeatHold() { reset(); }
+
+    void reset()
+    {
+        if (id)
+            seatHolds.release(exchange(id, 0));
+    }
+};
+
+
+// ---------- Communication Functions ----------
+//
+// No thread sits in recv() waiting for a client. One reactor thread watches
+// every socket with epoll, cuts what arrives into lines and queues them on
+// the client's Session. A small fixed pool of workers runs those jobs, one at
+// a time per session. The dialogue itself is a coroutine that suspends while
+// it waits for an answer, so an idle client costs a coroutine frame instead
+// of a thread and its stack.
+
+const size_t MAX_INPUT_LINE = 64 * 1024;
+// Past this much unsent output a client is too slow for live updates
+const size_t MAX_NOTICE_BACKLOG = 16 * 1024;
+
+// Fixed set of threads that run session jobs
+class WorkerPool
+{
+    mutex lock;
+    condition_variable ready;
+    deque<function<void()>> tasks;
+
+    void run();
+
+public:
+    void start(unsigned count);
+    void submit(function<void()> task);
+};
+
+void WorkerPool::start(unsigned count)
+{
+    for (unsigned i = 0; i < count; ++i)
+        thread(&WorkerPool::run, this).detach();
+}
+
+void WorkerPool::submit(function<void()> task)
+{
+    {
+        lock_guard<mutex> guard(lock);
+        tasks.push_back(move(task));
+    }
+    ready.notify_one();
+}
+
+void WorkerPool::run()
+{
+    while (true)
+    {
+        function<void()> task;
+        {
+            unique_lock<mutex> guard(lock);
+            ready.wait(guard, [this] { return !tasks.empty(); });
+            task = move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+WorkerPool workers;
+
+// Pending output of one session as a chain of buffers, flushed with a
+// single gathering sendmsg() (writev with MSG_NOSIGNAL) per attempt. Small
+// writes are copied into the tail buffer so a burst of messages goes out as
+// one segment; a large shared buffer (a cached seat chart) is referenced
+// rather than copied. Buffers that have been sent go back on a spare list
+// and are reused for the next response.
+class OutputChain
+{
+    static constexpr size_t CHUNK_SIZE = 16 * 1024;  // copy into the tail up to this
+    static constexpr size_t MAX_SPARE = 4;
+    static constexpr int MAX_IOV = 64;
+
+    struct Chunk
+    {
+        string owned;
+        shared_ptr<const string> shared;    // set for referenced buffers
+
+        string_view view() const { return shared ? string_view(*shared) : string_view(owned); }
+    };
+
+    deque<Chunk> chunks;
+    size_t frontSent = 0;                   // bytes of chunks.front() already sent
+    size_t pending = 0;
+    vector<string> spare;
+
+    string takeBuffer();
+    void consume(size_t n);
+
+public:
+    void append(string_view data);
+    void append(shared_ptr<const string> data);
+    bool empty() const { return pending == 0; }
+    size_t size() const { return pending; }
+    void clear();
+
+    // Sends as much as the socket takes right now; false once the peer is gone
+    bool flush(int fd);
+};
+
+string OutputChain::takeBuffer()
+{
+    if (spare.empty())
+    {
+        string fresh;
+        fresh.reserve(CHUNK_SIZE);
+        return fresh;
+    }
+    string buffer = move(spare.back());
+    spare.pop_back();
+    return buffer;
+}
+
+void OutputChain::append(string_view data)
+{
+    if (data.empty())
+        return;
+    pending += data.size();
+
+    Chunk *tail = chunks.empty() ? nullptr : &chunks.back();
+    if (tail && !tail->shared && tail->owned.size() + data.size() <= max(CHUNK_SIZE, tail->owned.capacity()))
+    {
+        tail->owned.append(data);
+        return;
+    }
+    Chunk chunk;
+    chunk.owned = takeBuffer();
+    chunk.owned.append(data);
+    chunks.push_back(move(chunk));
+}
+
+void OutputChain::append(shared_ptr<const string> data)
+{
+    if (!data || data->empty())
+        return;
+    // Not worth an iovec of its own
+    if (data->size() < CHUNK_SIZE / 16)
+    {
+        append(string_view(*data));
+        return;
+    }
+    pending += data->size();
+    Chunk chunk;
+    chunk.shared = move(data);
+    chunks.push_back(move(chunk));
+}
+
+void OutputChain::consume(size_t n)
+{
+    pending -= n;
+    while (n > 0)
+    {
+        Chunk &front = chunks.front();
+        size_t left = front.view().size() - frontSent;
+        if (n < left)
+        {
+            frontSent += n;
+            return;
+        }
+        n -= left;
+        frontSent = 0;
+        if (!front.shared && spare.size() < MAX_SPARE && front.owned.capacity() <= 4 * CHUNK_SIZE)
+        {
+            front.owned.clear();
+            spare.push_back(move(front.owned));
+        }
+        chunks.pop_front();
+    }
+}
+
+bool OutputChain::flush(int fd)
+{
+    while (pending > 0)
+    {
+        iovec iov[MAX_IOV];
+        int count = 0;
+        size_t skip = frontSent;
+        for (auto it = chunks.begin(); it != chunks.end() && count < MAX_IOV; ++it, skip = 0)
+        {
+            string_view v = it->view();
+            iov[count].iov_base = const_cast<char *>(v.data() + skip);
+            iov[count].iov_len = v.size() - skip;
+            ++count;
+        }
+
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        ssize_t n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (n > 0)
+        {
+            metrics.add(METRIC_BYTES_SENT, n);
+            consume(n);
+        }
+        else if (n < 0 && errno == EINTR)
+            continue;
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return true;
+        else
+            return false;
+    }
+    return true;
+}
+
+void OutputChain::clear()
+{
+    chunks.clear();
+    frontSent = 0;
+    pending = 0;
+}
+
+// ---------- Dialogue Coroutines ----------
+//
+// Every dialogue (a menu, a form, the booking loop) is a Task coroutine. It
+// reads like the old blocking code, but `co_await s.prompt(...)` suspends the
+// coroutine instead of the thread: the frame stays on the heap until the
+// client's answer arrives and a worker resumes it. A Task starts when it is
+// awaited, and when it finishes it resumes whoever awaited it.
+
+template <typename T>
+class Task;
+
+struct TaskPromiseBase
+{
+    coroutine_handle<> continuation = noop_coroutine();
+    exception_ptr error;
+
+    // Hand control back to the awaiting coroutine (or to the worker for a root task)
+    struct FinalAwaiter
+    {
+        bool await_ready() noexcept { return false; }
+        template <typename P>
+        coroutine_handle<> await_suspend(coroutine_handle<P> h) noexcept { return h.promise().continuation; }
+        void await_resume() noexcept {}
+    };
+
+    suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { error = current_exception(); }
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase
+{
+    optional<T> value;
+
+    Task<T> get_return_object();
+    void return_value(T v) { value = move(v); }
+    T result()
+    {
+        if (error)
+            rethrow_exception(error);
+        return move(*value);
+    }
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase
+{
+    Task<void> get_return_object();
+    void return_void() {}
+    void result()
+    {
+        if (error)
+            rethrow_exception(error);
+    }
+};
+
+// Owns its coroutine frame: destroying a Task destroys the frame, and with it
+// every local and every nested Task it was awaiting.
+template <typename T = void>
+class [[nodiscard]] Task
+{
+public:
+    using promise_type = TaskPromise<T>;
+    using Handle = coroutine_handle<promise_type>;
+
+    Task() = default;
+    explicit Task(Handle h) : handle(h) {}
+    Task(Task &&other) noexcept : handle(exchange(other.handle, {})) {}
+    Task &operator=(Task &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            handle = exchange(other.handle, {});
+        }
+        return *this;
+    }
+    ~Task() { reset(); }
+
+    // co_await task: run it, continue here when it is done
+    bool await_ready() const noexcept { return false; }
+    coroutine_handle<> await_suspend(coroutine_handle<> caller) noexcept
+    {
+        handle.promise().continuation = caller;
+        return handle;
+    }
+    T await_resume() { return handle.promise().result(); }
+
+    // For a root task that nobody awaits
+    void start() { handle.resume(); }
+    bool valid() const { return bool(handle); }
+    bool done() const { return handle.done(); }
+    T get() { return handle.promise().result(); }
+
+    void reset()
+    {
+        if (handle)
+            handle.destroy();
+        handle = {};
+    }
+
+private:
+    Handle handle;
+};
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() { return Task<T>(Task<T>::Handle::from_promise(*this)); }
+inline Task<void> TaskPromise<void>::get_return_object() { return Task<void>(Task<void>::Handle::from_promise(*this)); }
+
+// One connected client. The reactor thread owns the read side and the input
+// buffer. Everything else, including every resumption of the dialogue,
+// runs on the worker pool one job at a time per session, so the session is
+// the dialogue's executor and the coroutines never need locks of their own.
+class Session : public enable_shared_from_this<Session>
+{
+    static inline atomic<uint64_t> nextId{1};
+
+    int fd;
+    int epfd;
+    uint64_t id = nextId.fetch_add(1, memory_order_relaxed);   // never reused, unlike fd; names the session in spans
+    string pending;                 // input not yet split into lines/frames (reactor only)
+    bool modeKnown = false;         // first byte seen (reactor only)
+    bool framedInput = false;       // client opened with FRAME_SYNC (reactor only)
+    bool keepBlankLines;            // text mode: pass empty lines on instead of skipping them
+
+    mutex jobsLock;
+    deque<function<void()>> jobs;
+    bool running = false;           // a worker is draining jobs
+
+    mutex outLock;
+    OutputChain out;                // not yet taken by the kernel
+    bool watchingOut = false;       // EPOLLOUT is armed
+    bool closing = false;           // hang up once out drains
+    bool gone = false;              // the reactor has dropped us
+    bool readDone = false;          // the client shut its side; stop asking for EPOLLIN (set by the reactor)
+    bool framed = false;            // frames instead of PROMPT@ text
+    string heldNotices;             // text mode: notices wait for our next write, so PROMPT@ stays last
+
+    Task<> dialogue;                // the whole conversation
+    deque<string> answers;          // lines nobody has asked for yet
+    coroutine_handle<> waiting;     // suspended in prompt(), if anywhere
+    string lastPrompt;
+    bool inputClosed = false;       // every line the client sent has been handed to hear()
+
+    void runJobs();
+    void hear(const string &input);
+    void settle();
+    void useFrames();
+    void write(char type, string_view text, shared_ptr<const string> shared = nullptr);
+    void flushLocked();
+    bool readLines();
+    bool readFrames();
+
+public:
+    // co_await s.prompt(question) -> the client's next line
+    class Answer
+    {
+        Session &s;
+
+    public:
+        explicit Answer(Session &session) : s(session) {}
+        bool await_ready() const { return !s.answers.empty(); }
+        void await_suspend(coroutine_handle<> h) { s.waiting = h; }
+        string await_resume()
+        {
+            string input = move(s.answers.front());
+            s.answers.pop_front();
+            return input;
+        }
+    };
+
+    Session(int sock, int epoll, bool blankLines = false) : fd(sock), epfd(epoll), keepBlankLines(blankLines)
+    {
+        metrics.add(METRIC_SESSIONS_OPENED);
+    }
+    // A client that vanished mid-dialogue never gets its answer; the frame
+    // (and every local in it) is destroyed here instead.
+    ~Session()
+    {
+        close(fd);
+        metrics.add(METRIC_SESSIONS_CLOSED);
+    }
+
+    // Worker side (from inside the dialogue)
+    void send(const string &message);
+    void send(shared_ptr<const string> message);     // sent from the shared buffer, not copied
+    Answer prompt(const string &question);
+    Answer next();                  // the next line, without asking
+    void run(Task<> conversation);
+    void end();
+
+    // Any thread: run job on a worker after everything already queued
+    void post(function<void()> job);
+    // Any thread: best-effort push that never waits; dropped for slow clients
+    void notify(const string &text);
+
+    // Reactor side
+    bool readable();
+    void writable();
+    void drop();
+};
+
+void Session::post(function<void()> job)
+{
+    bool idle;
+    {
+        lock_guard<mutex> guard(jobsLock);
+        jobs.push_back(move(job));
+        idle = !running;
+        running = true;
+    }
+    if (idle)
+        workers.submit([self = shared_from_this()] { self->runJobs(); });
+}
+
+void Session::runJobs()
+{
+    while (true)
+    {
+        function<void()> job;
+        {
+            lock_guard<mutex> guard(jobsLock);
+            if (jobs.empty())
+            {
+                running = false;
+                return;
+            }
+            job = move(jobs.front());
+            jobs.pop_front();
+        }
+
+        spanSession = id;
+        try
+        {
+            Span span("turn");
+            job();
+            settle();
+        }
+        catch (const exception &e)
+        {
+            logger.log(LOG_ERROR, "❌ Session " + to_string(id) + " failed: " + e.what());
+            end();
+        }
+        spanSession = 0;
+    }
+}
+
+void Session::run(Task<> conversation)
+{
+    dialogue = move(conversation);
+    dialogue.start();
+}
+
+// The client answered: wake the dialogue if it is waiting for one
+void Session::hear(const string &input)
+{
+    answers.push_back(input);
+    if (waiting)
+        exchange(waiting, {}).resume();
+}
+
+// Once the dialogue has returned the conversation is over, and so it is
+// when the client has shut its side and the dialogue has answered all of it
+void Session::settle()
+{
+    if (inputClosed && waiting)
+    {
+        end();
+        return;
+    }
+    if (!dialogue.valid() || !dialogue.done())
+        return;
+    end();
+    Task<> finished = move(dialogue);
+    finished.get(); // rethrows anything the dialogue did not handle
+}
+
+void Session::send(const string &message)
+{
+    write(FRAME_MESSAGE, message);
+}
+
+void Session::send(shared_ptr<const string> message)
+{
+    string_view text = *message;
+    write(FRAME_MESSAGE, text, move(message));
+}
+
+Session::Answer Session::prompt(const string &question)
+{
+    lastPrompt = question;
+    write(FRAME_PROMPT, question);
+    return Answer(*this);
+}
+
+Session::Answer Session::next()
+{
+    return Answer(*this);
+}
+
+// Text clients recognise a question by the PROMPT@ marker it ends with;
+// framed clients by the frame type
+// text is copied into the output chain; if shared is given it holds the
+// same bytes and is referenced instead
+void Session::write(char type, string_view text, shared_ptr<const string> shared)
+{
+    if (logger.enabled(LOG_TRACE))
+        logger.log(LOG_TRACE, "[SEND " + to_string(fd) + "] " + string(text));
+
+    lock_guard<mutex> guard(outLock);
+    if (closing || gone)
+        return;
+    if (!heldNotices.empty())
+        out.append(exchange(heldNotices, string()));
+    if (framed)
+    {
+        char header[FRAME_HEADER_SIZE];
+        encodeFrameHeader(type, text.size(), header);
+        out.append(string_view(header, sizeof(header)));
+    }
+    if (shared)
+        out.append(move(shared));
+    else
+        out.append(text);
+    if (!framed && type == FRAME_PROMPT)
+        out.append("PROMPT@");
+    flushLocked();
+}
+
+// The client said HELLO. Anything already sent went out as text, which it
+// skips up to our FRAME_SYNC, so ask the pending question again as a frame.
+void Session::useFrames()
+{
+    lock_guard<mutex> guard(outLock);
+    if (closing || gone)
+        return;
+    framed = true;
+    out.append(string_view(&FRAME_SYNC, 1));
+    if (!heldNotices.empty())
+        out.append(encodeFrame(FRAME_NOTICE, exchange(heldNotices, string())));
+    if (waiting)
+        out.append(encodeFrame(FRAME_PROMPT, lastPrompt));
+    flushLocked();
+}
+
+// Hang up once everything queued so far has reached the socket
+void Session::end()
+{
+    lock_guard<mutex> guard(outLock);
+    closing = true;
+    flushLocked();
+}
+
+// Hand the kernel as much as it takes; the rest waits for EPOLLOUT
+void Session::flushLocked()
+{
+    if (gone)
+        return;
+    if (!out.flush(fd))
+        out.clear(); // peer is gone; the reactor will notice
+
+    bool wantOut = !out.empty();
+    if (wantOut != watchingOut)
+    {
+        epoll_event ev{};
+        ev.events = (readDone ? 0u : uint32_t(EPOLLIN)) | (wantOut ? uint32_t(EPOLLOUT) : 0u);
+        ev.data.fd = fd;
+        epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev);
+        watchingOut = wantOut;
+    }
+    if (closing && out.empty())
+        shutdown(fd, SHUT_RDWR);
+}
+
+// Read everything available and queue each complete answer for the
+// dialogue. Returns false once the client has gone.
+//
+// A client that shuts its sending side (`printf ... | nc -N`) still gets its
+// answers: what it sent before the EOF is queued as usual, a last line
+// without a newline included, and the session ends once the dialogue is
+// waiting for more and its output has drained. The EOF after that is ours.
+bool Session::readable()
+{
+    char buffer[4096];
+    bool eof = false;
+    while (true)
+    {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n > 0)
+        {
+            metrics.add(METRIC_BYTES_RECEIVED, n);
+            pending.append(buffer, n);
+        }
+        else if (n == 0)
+        {
+            lock_guard<mutex> guard(outLock);
+            if (readDone)
+                return false;
+            logger.log(LOG_INFO, "[RECV " + to_string(fd) + "] Client closed the connection.");
+            readDone = true;
+            eof = true;
+            epoll_event ev{};
+            ev.events = watchingOut ? uint32_t(EPOLLOUT) : 0u;
+            ev.data.fd = fd;
+            epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev);
+            break;
+        }
+        else if (errno == EINTR)
+            continue;
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+            break;
+        else
+            return false;
+    }
+
+    // A framed client announces itself with FRAME_SYNC, which text never contains
+    if (!modeKnown && !pending.empty())
+    {
+        modeKnown = true;
+        if (pending[0] == FRAME_SYNC)
+        {
+            framedInput = true;
+            pending.erase(0, 1);
+            post([this] { useFrames(); });
+        }
+    }
+
+    if (eof && !framedInput && !pending.empty() && pending.back() != '\n')
+        pending += '\n';
+    bool open = framedInput ? readFrames() : readLines();
+    if (open && eof)
+        post([this] { inputClosed = true; });
+    return open;
+}
+
+// Text mode: one answer per line
+bool Session::readLines()
+{
+    size_t start = 0, newline;
+    while ((newline = pending.find('\n', start)) != string::npos)
+    {
+        string input = trim(pending.substr(start, newline - start));
+        start = newline + 1;
+
+        // The text client sends a lone space to resync after blank input
+        if (input.empty() && !keepBlankLines)
+            continue;
+
+        if (input == "A client got disconnected")
+        {
+            logger.log(LOG_INFO, "⚠️  Client " + to_string(fd) + " disconnected using Ctrl+C.");
+            return false;
+        }
+
+        if (logger.enabled(LOG_TRACE))
+            logger.log(LOG_TRACE, "[RECV " + to_string(fd) + "] " + input);
+        post([this, input] { hear(input); });
+    }
+    pending.erase(0, start);
+
+    return pending.size() <= MAX_INPUT_LINE;
+}
+
+// Framed mode: one answer per FRAME_INPUT
+bool Session::readFrames()
+{
+    size_t pos = 0;
+    char type;
+    string payload;
+    while (true)
+    {
+        FrameStatus status = decodeFrame(pending, pos, MAX_INPUT_LINE, type, payload);
+        if (status == FRAME_TOO_LARGE)
+            return false;
+        if (status == FRAME_PARTIAL)
+            break;
+
+        if (type == FRAME_INPUT)
+        {
+            string input = trim(payload);
+            if (logger.enabled(LOG_TRACE))
+                logger.log(LOG_TRACE, "[RECV " + to_string(fd) + "] " + input);
+            post([this, input] { hear(input); });
+        }
+        else if (type == FRAME_BYE)
+        {
+            logger.log(LOG_INFO, "⚠️  Client " + to_string(fd) + " disconnected.");
+            return false;
+        }
+        else if (type != FRAME_HELLO)
+            return false; // not our protocol
+    }
+    pending.erase(0, pos);
+    return true;
+}
+
+void Session::writable()
+{
+    lock_guard<mutex> guard(outLock);
+    flushLocked();
+}
+
+void Session::drop()
+{
+    lock_guard<mutex> guard(outLock);
+    gone = true;
+    out.clear();
+}
+
+// Called from other sessions' workers. If our own worker is flushing, or the
+// client has not read what it already has, the notice is simply skipped: the
+// chart it would have updated is redrawn in full the next time anyway.
+void Session::notify(const string &text)
+{
+    unique_lock<mutex> guard(outLock, try_to_lock);
+    if (!guard.owns_lock() || closing || gone || out.size() + heldNotices.size() > MAX_NOTICE_BACKLOG)
+        return;
+    // A text client only answers output that ends in PROMPT@, so a notice
+    // appended after an open question would leave it waiting forever
+    if (!framed)
+    {
+        heldNotices += text;
+        return;
+    }
+    out.append(encodeFrame(FRAME_NOTICE, text));
+    flushLocked();
+}
+
+// ---------- Live Seat Updates ----------
+// Sessions looking at a trip's seat chart subscribe to it, and every booking
+// on that trip pushes a one-line delta to them. Publishing copies the
+// subscriber list and notifies outside the registry lock, so the booking
+// path only ever pays for a few non-blocking sends.
+class SeatFeed
+{
+    mutex lock;
+    unordered_map<string, unordered_map<Session *, weak_ptr<Session>>> watchers;   // TripID -> sessions
+
+public:
+    void subscribe(const string &tripId, Session &s);
+    void unsubscribe(const string &tripId, Session &s);
+    void publish(const string &tripId, const string &text, const Session *except = nullptr);
+};
+
+void SeatFeed::subscribe(const string &tripId, Session &s)
+{
+    lock_guard<mutex> guard(lock);
+    watchers[tripId][&s] = s.weak_from_this();
+}
+
+void SeatFeed::unsubscribe(const string &tripId, Session &s)
+{
+    lock_guard<mutex> guard(lock);
+    auto trip = watchers.find(tripId);
+    if (trip == watchers.end())
+        return;
+    trip->second.erase(&s);
+    if (trip->second.empty())
+        watchers.erase(trip);
+}
+
+void SeatFeed::publish(const string &tripId, const string &text, const Session *except)
+{
+    vector<shared_ptr<Session>> targets;
+    {
+        lock_guard<mutex> guard(lock);
+        auto trip = watchers.find(tripId);
+        if (trip == watchers.end())
+            return;
+        for (auto &w : trip->second)
+            if (w.first != except)
+                if (auto session = w.second.lock())
+                    targets.push_back(move(session));
+    }
+    for (auto &session : targets)
+        session->notify(text);
+}
+
+SeatFeed seatFeed;
+
+// Subscribes a session to one trip for as long as it is in scope
+struct SeatWatch
+{
+    Session &s;
+    string tripId;
+
+    SeatWatch(Session &session, const string &trip) : s(session), tripId(trip) { seatFeed.subscribe(tripId, s); }
+    SeatWatch(const SeatWatch &) = delete;
+    SeatWatch &operator=(const SeatWatch &) = delete;
+    ~SeatWatch() { seatFeed.unsubscribe(tripId, s); }
+};
+
+
+
+
+
+// BOOKING A SEAT (lock-free claim in the seat store)
+
+// "12" -> 12; anything that is not a plain seat number -> 0
+int parseSeatNo(const string &seatChoice)
+{
+    if (seatChoice.empty() || seatChoice.size() > 4 ||
+        !all_of(seatChoice.begin(), seatChoice.end(), ::isdigit))
+        return 0;
+    return stoi(seatChoice);
+}
+
+// Aadhar validation
+bool isValidAadhar(const string &aadhar)
+{
+    return aadhar.length() == 12 && all_of(aadhar.begin(), aadhar.end(), ::isdigit);
+}
+bool isAadharExist(const string &aadhar)
+{
+    return identities.userExists(aadhar);
+} // d
+
+// License validation
+bool isValidLicense(const string &license)
+{
+    return (license.length() == 16);
+}
+
+bool isLicenseExist(const string &license)
+{
+    return identities.licenseExists(license);
+} // d
+
+// CURRENT TIME CHECKING
+
+// bool isTimeAfterNow(const string &timeStr)
+// {
+//     int tripHour, tripMin;
+//     char colon;
+//     stringstream ss(timeStr);
+//     if (!(ss >> tripHour >> colon >> tripMin) || colon != ':')
+//     {
+//         return false; // Invalid time
+//     }
+
+//     time_t now = time(0);
+//     tm *ltm = localtime(&now);
+//     int currMinutes = ltm->tm_hour * 60 + ltm->tm_min;
+//     int tripMinutes = tripHour * 60 + tripMin;
+
+//     return tripMinutes > currMinutes;
+// } // d
+
+
+//Printing the SEAT MATRIX 
+
+// Rendered seat charts, one per trip. A chart is only rebuilt from scratch
+// the first time a trip is viewed; after that a view costs one version check
+// and a copy, and a booking or hold re-renders just the seats whose icon
+// changed. The cache is keyed by the trip's seat version (bumped by every
+// claim in seats.bin) and its hold version.
+class SeatCharts
+{
+    struct Chart
+    {
+        ProfiledMutex<mutex> lock{"seat_chart"};
+        bool built = false;
+        uint32_t seatVersion = 0;
+        uint64_t holdVersion = 0;
+        shared_ptr<const string> text;  // replaced, never modified, so views can keep it
+        vector<size_t> cellAt;          // offset of seat n's icon is cellAt[n - 1]
+        vector<const char *> icons;     // icon currently drawn for seat n
+    };
+
+    shared_mutex lock;
+    unordered_map<string, shared_ptr<Chart>> charts;
+
+    shared_ptr<Chart> chartFor(const string &tripId);
+    static void build(Chart &chart, const string &tripId, const SeatSnapshot &seats, const vector<const char *> &icons);
+
+public:
+    shared_ptr<const string> render(const string &tripId);
+};
+
+const char SEAT_FREE[] = "💺", SEAT_HELD[] = "⏳", SEAT_BOOKED[] = "❌";
+
+shared_ptr<SeatCharts::Chart> SeatCharts::chartFor(const string &tripId)
+{
+    {
+        shared_lock<shared_mutex> guard(lock);
+        auto it = charts.find(tripId);
+        if (it != charts.end())
+            return it->second;
+    }
+    unique_lock<shared_mutex> guard(lock);
+    auto &chart = charts[tripId];
+    if (!chart)
+        chart = make_shared<Chart>();
+    return chart;
+}
+
+shared_ptr<const string> SeatCharts::render(const string &tripId)
+{
+    MetricTimer timer(METRIC_SEAT_CHART);
+    Span span("SeatCharts::render");
+    shared_ptr<Chart> chart = chartFor(tripId);
+    auto guard = lockTimed(chart->lock, METRIC_WAIT_SEAT_CHART);
+
+    // Versions are read before the seats, so a change that races with us
+    // leaves the chart marked older than what it shows and gets redrawn
+    uint32_t seatVersion = seatStore.version(tripId);
+    uint64_t holdVersion = seatHolds.version(tripId);
+    if (chart->built && chart->seatVersion == seatVersion && chart->holdVersion == holdVersion)
+        return chart->text;
+
+    SeatSnapshot seats;
+    seatStore.snapshot(tripId, seats); // Load seat data
+    vector<int> heldSeats = seatHolds.held(tripId);
+
+    vector<const char *> icons(seats.seatCount(), SEAT_FREE);
+    for (int seatNo : heldSeats)
+        if (seats.isValidSeat(seatNo))
+            icons[seatNo - 1] = SEAT_HELD;
+    for (int seatNo = 1; seatNo <= seats.seatCount(); ++seatNo)
+        if (seats.isBooked(seatNo))
+            icons[seatNo - 1] = SEAT_BOOKED;
+
+    if (!chart->built || chart->icons.size() != icons.size())
+        build(*chart, tripId, seats, icons);
+    else if (icons != chart->icons)
+    {
+        // Patch the cells that changed; later cells shift by the size difference
+        string text = *chart->text;
+        for (size_t i = 0; i < icons.size(); ++i)
+        {
+            if (icons[i] == chart->icons[i])
+                continue;
+            size_t oldLen = strlen(chart->icons[i]), newLen = strlen(icons[i]);
+            text.replace(chart->cellAt[i], oldLen, icons[i]);
+            for (size_t j = i + 1; j < icons.size(); ++j)
+                chart->cellAt[j] += newLen - oldLen;
+            chart->icons[i] = icons[i];
+        }
+        chart->text = make_shared<const string>(move(text));
+    }
+    chart->seatVersion = seatVersion;
+    chart->holdVersion = holdVersion;
+    return chart->text;
+}
+
+void SeatCharts::build(Chart &chart, const string &tripId, const SeatSnapshot &seats, const vector<const char *> &icons)
+{
+    int rows = seats.rows, cols = seats.cols;
+    chart.cellAt.assign(icons.size(), 0);
+    chart.icons = icons;
+    chart.built = true;
+
+    stringstream response;
+    response << "SEAT CHART FOR THE TRIP " << tripId << "\n";
+
+    // GATE and driver header
+   stringstream ss;
+ss << "\n╔═══════════════════════════════╗";
+ss << "\n║         BUS SEAT STATUS       ║";
+ss << "\n╠═══════╦═══════════════════════╣";
+ss << "\n║ G     ║    DRIVER SEAT        ║";
+ss << "\n║       ╠═══════════════════════╣";
+ss << "\n║ A     ║ Seat Position: Optimal║";
+ss << "\n║ T     ║ Temperature:  22°C    ║";
+ss << "\n║ E     ║ Occupancy:    Detected║";
+ss << "\n╚═══════╩═══════════════════════╝";
+response << ss.str() << "\n\n";
+
+    int leftCols = cols / 2;
+    int rightCols = cols - leftCols;
+    int seatIndex = 0;
+
+    for (int row = 0; row < rows; ++row) {
+        stringstream iconLine;
+        stringstream numberLine;
+        vector<pair<int, size_t>> cells;   // seat index, offset within iconLine
+
+        iconLine << "|";
+        numberLine << "|";
+
+        auto seatCell = [&]() {
+            if (seats.isValidSeat(seatIndex + 1)) {
+                cells.push_back({seatIndex, size_t(iconLine.tellp())});
+                iconLine << setw(2) << icons[seatIndex] << " ";
+                numberLine << setw(2) << setfill('0') << (seatIndex + 1) << " ";
+            } else {
+                iconLine << setw(3) << " ";
+                numberLine << setw(3) << " ";
+            }
+            ++seatIndex;
+        };
+
+        // Left side
+        for (int i = 0; i < leftCols; ++i)
+            seatCell();
+
+        // Middle aisle spacing
+        int aisleSpacing = 31 - (leftCols + rightCols) * 3 - 2; // 2 for '|'
+        iconLine << string(aisleSpacing, ' ');
+        numberLine << string(aisleSpacing, ' ');
+
+        // Right side
+        for (int i = 0; i < rightCols; ++i)
+            seatCell();
+
+        iconLine << " |";
+        numberLine << " |";
+
+        size_t lineStart = response.tellp();
+        for (auto &cell : cells)
+            chart.cellAt[cell.first] = lineStart + cell.second;
+        response << iconLine.str() << "\n";
+        response << numberLine.str() << "\n";
+    }
+    response << "\n|===============================|";
+    response << "\n 💺 = Available, ⏳ = On hold, ❌ = Booked\n";
+
+    // Collect price details
+    string windowPrice = "N/A";
+    string middlePrice = "N/A";
+    string backWindowPrice = "N/A";
+    string backMiddlePrice = "N/A";
+
+    if (seats.seatCount() > 0) {
+        windowPrice = to_string(seats.classPrice[WINDOW_SEAT]);
+        backWindowPrice = to_string(seats.classPrice[BACK_WINDOW_SEAT]);
+
+        // Middle seats only exist with more than 2 columns
+        if (cols > 2) {
+            middlePrice = to_string(seats.classPrice[MIDDLE_SEAT]);
+            backMiddlePrice = to_string(seats.classPrice[BACK_MIDDLE_SEAT]);
+        }
+    }
+
+    // Build the price details response
+    response << "\n IMPORTANT PRICE DETAILS\n";
+    if (cols > 2) {
+        response << "1. LOWER PRICE FOR MIDDLE SEATS: " << middlePrice << "\n";
+    } else {
+        response << "1. LOWER PRICE FOR MIDDLE SEATS: Not applicable (no middle seats in 2-column layout)\n";
+    }
+
+    response << "2. MORE LOWER PRICES FOR BACK SEATS -> BACK WINDOW: " << backWindowPrice;
+    if (cols > 2) {
+        response << ", BACK MIDDLE: " << backMiddlePrice;
+    }
+    response << "\n";
+
+    response << "3. PRICE HIKE FOR WINDOW SEATS: " << windowPrice << "\n";
+
+    chart.text = make_shared<const string>(response.str());
+}
+
+SeatCharts seatCharts;
+
+void seatMatrix(const string &tripId, Session &s) {
+    Span span("seatMatrix");
+    s.send(seatCharts.render(tripId));
+}
+
+// --- CLASS DECLARATIONS ---
+
+class User
+{
+public:
+    Task<> registerUser(Session &s);
+    Task<string> login(Session &s);
+};
+
+// reservation handler
+class ReservationHandler
+{
+private:
+    string uid;
+
+public:
+    ReservationHandler(string userID) : uid(userID) {}
+
+    void viewTickets(Session &s);
+    vector<UpcomingTrip> viewTrips(Session &s);
+    Task<> reserve(Session &s);
+};
+
+// driver class
+class Driver
+{
+public:
+    Task<> registerDriver(Session &s);
+    Task<string> loginDriver(Session &s);
+};
+
+//------BUS_TRIP_HANDLER-------------
+
+class bus_trip_handler
+{
+    string aadhar;
+
+public:
+    bus_trip_handler(string a) : aadhar(a) {}; // constructor
+
+    Task<> registerBus(Session &s);
+    Task<> insertTrip(Session &s);
+    Task<> insertTimetable(Session &s);
+}; // d
+
+// --------- Create Seat File Function----------
+// Seat layout and class prices for a new trip, built entirely in memory
+SeatLayout seatLayoutFor(const string &tripId, int rows, int cols, float dist)
+{
+    // Base price per seat class, scaled by distance
+    int multiplier = ceil(dist / 80.0);
+
+    SeatLayout layout;
+    layout.tripId = tripId;
+    layout.rows = rows;
+    layout.cols = cols;
+    layout.classPrice[WINDOW_SEAT] = 150 * multiplier;      // Window seats (not back row)
+    layout.classPrice[MIDDLE_SEAT] = 120 * multiplier;      // Middle seats (not back row)
+    layout.classPrice[BACK_WINDOW_SEAT] = 105 * multiplier; // Back window seats
+    layout.classPrice[BACK_MIDDLE_SEAT] = 100 * multiplier; // Back middle seats
+    return layout;
+}
+
+// --- USER METHODS ---
+
+//------------USER REGISTER--------------------------
+Task<> User::registerUser(Session &s)
+{
+    string name = co_await s.prompt("Enter your Name:");
+
+    int age = 0;
+    while (true)
+    {
+        string ageinput = co_await s.prompt("Enter your Age:");
+        try
+        {
+            age = stoi(ageinput);
+            if (age < 1)
+                s.send("Children below 1 year of age are not eligible for safety concerns.\n");
+            else if (age > 150)
+                s.send("❌ Enter realistic age data.\n");
+            else
+                break;
+        }
+        catch (logic_error &e)
+        {
+            s.send("❌ Invalid input. Please enter a number for age.\n");
+        }
+    }
+
+    string aadhar;
+    while (true)
+    {
+        aadhar = co_await s.prompt("Enter your Unique Aadhar number:");
+        if (!isValidAadhar(aadhar))
+        {
+            s.send("❌ Invalid Aadhar number. It must be 12 digits.\n");
+            continue;
+        }
+        if (isAadharExist(aadhar))
+        {
+            string ans = co_await s.prompt("This Aadhar number is already registered.\nIs it a Typo error? (y/n): ");
+            if (ans == "y" || ans == "Y")
+            {
+                s.send("No worries, Re-enter again.\n");
+                continue;
+            }
+            else
+            {
+                s.send("You're already registered. Please login instead.\n");
+                co_return;
+            }
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    string password = co_await s.prompt("Enter a Strong Password:");
+
+     // Hash the password
+    char hash[SHA256_DIGEST_LENGTH * 2 + 1];
+    hash_password(password.c_str(), hash);
+
+    // writeFile(USER_FILE, {aadhar, name, to_string(age), password});
+    if (!identities.addUser(aadhar, name, to_string(age), string(hash)))
+    {
+        s.send("You're already registered. Please login instead.\n");
+        co_return;
+    }
+    s.send("✅ Registration Successful!\n");
+} // d
+
+//----------USER LOGIN----------------
+Task<string> User::login(Session &s)
+{
+    string aadhar = co_await s.prompt("Enter Your Aadhar Number:");
+    string password = co_await s.prompt("Enter Your Password:");
+    MetricTimer timer(METRIC_LOGIN);
+    Span span("login");
+
+    // Hash the entered password
+    char hashedPassword[SHA256_DIGEST_LENGTH * 2 + 1];
+    hash_password(password.c_str(), hashedPassword);
+
+    if (identities.checkUserPassword(aadhar, hashedPassword))
+    {
+        s.send("✅ Login Successful!\n");
+        co_return aadhar;
+    }
+
+    s.send("❌ Invalid Aadhar number or Password.\n");
+    co_return "";
+} // d
+
+//------DRIVER CLASS-----------------
+
+Task<> Driver::registerDriver(Session &s)
+{
+
+    // Asking for name
+    string name = co_await s.prompt("Enter your Name:");
+
+    // asking for age
+    int age = 0;
+    while (true)
+    {
+        string ageinput = co_await s.prompt("Enter your Age:");
+        try
+        {
+            age = stoi(ageinput);
+            if (age < 25 || age > 60)
+                s.send("Not Eligible to register here as a driver.\n");
+            else
+                break;
+        }
+        catch (logic_error &e)
+        {
+            s.send("❌ Invalid input. Please enter a number for age.\n");
+        }
+    }
+
+    // Asking for Aadhar no
+    string aadhar;
+    while (true)
+    {
+        aadhar = co_await s.prompt("Enter your Unique Aadhar number:");
+        if (!isValidAadhar(aadhar))
+        {
+            s.send("❌ Invalid Aadhar number. It must be 12 digits.\n");
+            continue;
+        }
+        if (isAadharExist(aadhar))
+        {
+            string ans = co_await s.prompt("This Aadhar number is already registered.\nIs it a Typo error? (y/n): ");
+            if (ans == "y" || ans == "Y")
+            {
+                s.send("No worries, Re-enter again.\n");
+                continue;
+            }
+            else
+            {
+                s.send("You're already registered. Please login instead.\n");
+                co_return;
+            }
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    // Asking for license
+    string license;
+    while (true)
+    {
+        license = co_await s.prompt("Enter your Unique License number:");
+        if (!isValidLicense(license))
+        {
+            s.send("❌ Invalid License number.\n");
+            continue;
+        }
+        if (isLicenseExist(license))
+        {
+            string ans = co_await s.prompt("This License number is already registered.\nIs it a Typo error? (y/n): ");
+            if (ans == "y" || ans == "Y")
+            {
+                s.send("No worries, Re-enter again.\n");
+                continue;
+            }
+            else
+            {
+                s.send("You're already registered. Please login instead.\n");
+                co_return;
             }
         }
-        else
+        else
+        {
+            break;
+        }
+    }
+
+    string password = co_await s.prompt("Enter a Strong Password:");
+
+    // Hash the password
+    char hash[SHA256_DIGEST_LENGTH * 2 + 1];
+    hash_password(password.c_str(), hash);
+
+    // writeFile(DRIVER_FILE, {aadhar, license, name, to_string(age), password});
+    if (!identities.addDriver(aadhar, license, name, to_string(age), string(hash)))
+    {
+        s.send("You're already registered. Please login instead.\n");
+        co_return;
+    }
+    s.send("✅ Registration Successful!\n");
+} // d
+
+//--------------LOGIN DRIVER-----------------
+Task<string> Driver::loginDriver(Session &s)
+{
+    string aadhar = co_await s.prompt("Enter Your Aadhar Number:");
+
+    string password = co_await s.prompt("Enter Your Password:");
+    MetricTimer timer(METRIC_LOGIN);
+    Span span("login");
+
+    // Hash the entered password
+    char hashedPassword[SHA256_DIGEST_LENGTH * 2 + 1];
+    hash_password(password.c_str(), hashedPassword);
+
+    if (identities.checkDriverPassword(aadhar, hashedPassword))
+    {
+        s.send("✅ Login Successful!\n");
+        co_return aadhar;
+    }
+
+    s.send("❌ Invalid Aadhar number or Password.\n");
+    co_return "";
+}
+
+//-------------Insert a Trip(bus_trip_handler)------------------
+// Function to split string by delimiter
+vector<string> split(const string &s, char delimiter)
+{
+    vector<string> tokens;
+    string token;
+    istringstream tokenStream(s);
+    while (getline(tokenStream, token, delimiter))
+    {
+        tokens.push_back(token);
+    }
+    return tokens;
+}
+
+// Function to validate date and compare
+bool validateAndCompareDate(const string &departDate, time_t &timestamp, const string &startTime)
+{
+    vector<string> parts = split(departDate, '/');
+    vector<string> timeParts = split(startTime, ':');
+
+    // Check for proper format
+    if (parts.size() != 3)
+        return false;
+
+    int day, month, year, hh, mm;
+    try
+    {
+        day = stoi(parts[0]);
+        month = stoi(parts[1]);
+        year = stoi(parts[2]);
+        hh = stoi(timeParts[0]);
+        mm = stoi(timeParts[1]);
+    }
+    catch (...)
+    {
+        return false; // Non-numeric input
+    }
+
+    // Basic range checks
+    if (month < 1 || month > 12 || day < 1 || day > 31 || year < 1900)
+        return false;
+
+    // Set up struct tm
+    struct tm datetime = {};
+    datetime.tm_year = year - 1900;
+    datetime.tm_mon = month - 1;
+    datetime.tm_mday = day;
+    datetime.tm_hour = hh;
+    datetime.tm_min = mm;
+    datetime.tm_sec = 0;
+    datetime.tm_isdst = -1;
+
+    // Convert to time_t
+    timestamp = mktime(&datetime);
+    if (timestamp == -1)
+        return false; // Invalid timestamp
+
+    // Compare with current time
+    time_t now = time(NULL);
+    if (difftime(timestamp, now) < 0)
+    {
+        // Date is in the past
+        return false;
+    }
+
+    // Valid and in future
+    return true;
+}
+
+// True if any of the bus's trips leaves on the same date within 60 minutes
+bool clashesWithSchedule(const vector<Trip> &busTrips, const string &departDate, const string &startTime)
+{
+    for (auto &trip : busTrips)
+    {
+        string existingDateTime = trip.departure;
+        string existingDate = extractDateDDMMYYYY(existingDateTime);
+
+        if (existingDate == departDate)
+        {
+            string existingTime = extractTime(existingDateTime);  // "HH:MM"
+
+            if (!isTimeDifferenceSafe(existingTime, startTime))
+                return true;
+        }
+    }
+    return false;
+}
+
+//-----------INSERT TRIPS----------------
+// Validates one trip, stores it and creates its seat layout. Both the driver
+// menu and the machine API schedule through here. Returns the new Trip ID,
+// or "" with error set.
+string scheduleTrip(const string &driverAadhar, const string &busNo, const string &source,
+                    const string &destination, const string &departDate, const string &startTime,
+                    const string &distance, string &error)
+{
+    float dist;
+    try
+    {
+        dist = stof(distance);
+    }
+    catch (logic_error &e)
+    {
+        error = "Invalid input. Please enter a number";
+        return "";
+    }
+
+    int rows = -1, cols = -1;
+    findBusLayout(busNo, rows, cols);
+    time_t timestamp;
+    string departure = "";
+    if (split(startTime, ':').size() != 2 || validateAndCompareDate(departDate, timestamp, startTime) == false)
+    {
+        error = "Departure date or time invalid.";
+        return "";
+    }
+    else
+    {
+
+        departure = ctime(&timestamp);
+        if (!departure.empty() && departure.back() == '\n')
         {
+            departure.pop_back();
+        }
+    }
+
+    if (rows <= 0 || cols <= 0)
+    {
+        error = "Bus not found or invalid seat dimensions.";
+        return "";
+    }
+
+    if (clashesWithSchedule(tripStore.tripsForBus(busNo), departDate, startTime))
+    {
+        error = "A trip with this bus is already scheduled on the same date within 60 minutes.";
+        return "";
+    }
+
+    // The seats are created first, so a trip is never listed without them
+    string tripID = tripStore.insert({"", busNo, source, destination, distance, driverAadhar, departure},
+                                     [&](const vector<Trip> &trips) {
+                                         return seatStore.createMany({seatLayoutFor(trips[0].id, rows, cols, dist)});
+                                     });
+    if (tripID.empty())
+    {
+        logger.log(LOG_ERROR, "❌ Could not save a trip for bus " + busNo + " (seat layout or trips.txt)");
+        error = "The trip could not be saved. Please try again.";
+    }
+    return tripID;
+}
+
+Task<> bus_trip_handler::insertTrip(Session &s)
+{
+    string busNo = co_await s.prompt("Enter Bus Number: ");
+
+    string source = co_await s.prompt("Enter Source: ");
+
+    string destination = co_await s.prompt("Enter Destination: ");
+
+    string departDate = co_await s.prompt("Enter Departure Date (DD/MM/YYYY): ");
+
+    string startTime = co_await s.prompt("Enter Start Time (HH:MM): ");
+
+    string distance = co_await s.prompt("Enter the Total Distance being covered in KM:");
+
+    string error;
+    string tripID = scheduleTrip(aadhar, busNo, source, destination, departDate, startTime, distance, error);
+    if (tripID.empty())
+    {
+        s.send("❌ " + error + "\n");
+        co_return;
+    }
+
+    s.send("✅ A Trip is being inserted successfully with Trip ID " + tripID + "\n");
+} // d
+
+//-----------INSERT A WHOLE TIMETABLE----------------
+Task<> bus_trip_handler::insertTimetable(Session &s)
+{
+    s.send("Enter one trip per line as:\n"
+           "BusNo,Source,Destination,DD/MM/YYYY,HH:MM,KM\n"
+           "Type 'done' when the timetable is complete.\n");
+
+    unordered_map<string, pair<int, int>> layouts = loadBusLayouts();
+
+    vector<Trip> batch;
+    vector<pair<string, float>> batchDist;   // bus number and distance per batch entry
+    unordered_map<string, vector<Trip>> scheduled;   // bus -> existing + accepted trips
+    int lineNo = 0;
+
+    while (true)
+    {
+        string line = co_await s.prompt("Trip " + to_string(lineNo + 1) + " (or done): ");
+        if (line == "done")
             break;
+        ++lineNo;
+
+        vector<string> f = split(line, ',');
+        for (auto &field : f)
+            field = trim(field);
+        string where = "❌ Line " + to_string(lineNo) + ": ";
+        if (f.size() != 6)
+        {
+            s.send(where + "expected 6 comma separated fields.\n");
+            continue;
+        }
+
+        string busNo = f[0], source = f[1], destination = f[2];
+        string departDate = f[3], startTime = f[4], distance = f[5];
+
+        auto bus = layouts.find(busNo);
+        if (bus == layouts.end() || bus->second.first <= 0 || bus->second.second <= 0)
+        {
+            s.send(where + "bus not found or invalid seat dimensions.\n");
+            continue;
+        }
+
+        float dist;
+        try
+        {
+            dist = stof(distance);
+        }
+        catch (...)
+        {
+            s.send(where + "distance must be a number.\n");
+            continue;
+        }
+
+        time_t timestamp;
+        if (split(startTime, ':').size() != 2 || !validateAndCompareDate(departDate, timestamp, startTime))
+        {
+            s.send(where + "departure date or time invalid.\n");
+            continue;
+        }
+        string departure = ctime(&timestamp);
+        if (!departure.empty() && departure.back() == '\n')
+            departure.pop_back();
+
+        if (!scheduled.count(busNo))
+            scheduled[busNo] = tripStore.tripsForBus(busNo);
+        if (clashesWithSchedule(scheduled[busNo], departDate, startTime))
+        {
+            s.send(where + "bus " + busNo + " already leaves within 60 minutes of that time.\n");
+            continue;
+        }
+
+        Trip t = {"", busNo, source, destination, distance, aadhar, departure};
+        scheduled[busNo].push_back(t);
+        batch.push_back(t);
+        batchDist.push_back({busNo, dist});
+    }
+
+    if (batch.empty())
+    {
+        s.send("No trips were inserted.\n");
+        co_return;
+    }
+
+    // One seat-store write and one append to trips.txt for the whole batch.
+    // The seats go first, so no trip is ever listed without them.
+    vector<string> ids = tripStore.insertMany(batch, [&](const vector<Trip> &trips) {
+        vector<SeatLayout> seatLayouts;
+        for (size_t i = 0; i < trips.size(); ++i)
+        {
+            auto &dims = layouts[batchDist[i].first];
+            seatLayouts.push_back(seatLayoutFor(trips[i].id, dims.first, dims.second, batchDist[i].second));
+        }
+        return seatStore.createMany(seatLayouts);
+    });
+    if (ids.empty())
+    {
+        logger.log(LOG_ERROR, "❌ Could not save a timetable of " + to_string(batch.size()) + " trips (seat layouts or trips.txt)");
+        s.send("❌ Could not save the timetable. No trips were inserted.\n");
+        co_return;
+    }
+
+    s.send("✅ " + to_string(ids.size()) + " trips inserted: " + ids.front() +
+           (ids.size() > 1 ? " to " + ids.back() : "") + "\n");
+}
+
+//-----------Register a bus-------------
+Task<> bus_trip_handler::registerBus(Session &s)
+{
+    string busNo = co_await s.prompt("Enter Bus Number (unique ID): ");
+
+    // Check if busNo already exists
+    CsvFile buses;
+    buses.load(BUS_FILE);
+    for (auto b : buses)
+    {
+        if (!b.empty() && b[0] == busNo)
+        {
+            s.send("❌ Bus Number already registered.\n");
+            co_return;
+        }
+    }
+
+    // Get rows
+    string rowStr = co_await s.prompt("Enter number of seat rows: ");
+
+    // Get columns
+    string colStr = co_await s.prompt("Enter number of seat columns: ");
+
+    // Validate inputs
+    try
+    {
+        int rows = stoi(rowStr);
+        int cols = stoi(colStr);
+
+        if (rows <= 0 || cols <= 0)
+        {
+            s.send("❌ Invalid row or column count for a bus\n");
+            co_return;
+        }
+        if (rows * cols > MAX_SEATS)
+        {
+            s.send("❌ A bus can have at most " + to_string(MAX_SEATS) + " seats\n");
+            co_return;
+        }
+
+        {
+            auto guard = lockTimed(mtx, METRIC_WAIT_APPEND);
+            writeFile("buses.txt", {busNo, aadhar, rowStr, colStr});
         }
+
+        s.send("✅ Bus registered successfully.\n");
+    }
+    catch (...)
+    {
+        s.send("❌ Invalid input. Please enter numeric values.\n");
+    }
+} // d
+
+//-----------RESERVATION HANDLER-----------------
+
+//-------------VIEW TICKETS----------
+void ReservationHandler::viewTickets(Session &s)
+{
+    // auto bookings = readFile("bookings.txt");
+    // string response = "🧾 Your Bookings:\n";
+    // int count = 0;
+
+    // for (auto &b : bookings)
+    // {
+    //     if (b.size() >= 5 && b[3] == uid)
+    //     {
+    //         response += to_string(++count) + ". Trip ID: " + b[0] + ",Bus No:" + b[1] + ", Seat No: " + b[2] + "\n";
+    //     }
+    // }
+
+    // if (count == 0)
+    // {
+    //     response = "❌ No bookings found under your ID.\n";
+    // }
+
+    // s.send(response);
+    string response = "🎫 Your Booked Tickets:\n\n";
+    int count = 0;
+
+    for (auto &b : bookingIndex.forPassenger(uid))
+    {
+        string tripID = b.tripId;
+        string busNo = b.busNo;
+        string seatNo = b.seatNo;
+        string maskedAadhar = string(b.aadhar.length() - 4, 'X') + b.aadhar.substr(b.aadhar.length() - 4);
+        string username = b.name;
+        string price = b.price;
+        string bookingTime = b.bookedAt;
+
+        // Find the corresponding trip in the catalog
+        Trip tripInfo;
+        if (!tripStore.find(tripID, tripInfo))
+            continue; // Skip if no matching trip found
+
+        string source = tripInfo.source;
+        string destination = tripInfo.destination;
+        string departure = tripInfo.departure;
+
+        response += "-----------------------------------------\n";
+        response += "🚌 Ticket #" + to_string(++count) + "\n";
+        response += "Trip ID       : " + tripID + "\n";
+        response += "Bus Number    : " + busNo + "\n";
+        response += "Seat Number   : " + seatNo + "\n";
+        response += "Name          : " + username + "\n";
+        response += "Aadhar Number : " + maskedAadhar + "\n";
+        response += "Ticket Price  : ₹" + price + "\n";
+        response += "Booking Time  : " + bookingTime + "\n";
+        response += "-----------------------------------------\n";
+        response += "Route         : " + source + " ➡ " + destination + "\n";
+        response += "Departure Date: " + departure + "\n";
+        response += "=========================================\n\n";
+    }
+
+    if (count == 0)
+    {
+        response = "❌ No bookings found under your ID.\n";
+    }
+
+    s.send(response);
+}
+
+//-----------VIEW TRIPS--------------
+vector<UpcomingTrip> ReservationHandler::viewTrips(Session &s)
+{
+    MetricTimer timer(METRIC_VIEW_TRIPS);
+    Span span("viewTrips");
+    // Already ordered by departure, departed trips already dropped
+    vector<UpcomingTrip> upcomingTrips = tripStore.upcoming(time(nullptr));
+
+    for (auto &t : upcomingTrips)
+    {
+        if (t.discount)
+            t.trip.departure += " [ DISCOUNT-⚠️ Less than 1 hour left! Price Decreased - Hurry!]";
+    }
+
+    if (upcomingTrips.empty())
+    {
+        s.send("❌ No upcoming trips are available.\n");
     }
 
-    sendPrompt(sock, "Enter a Strong Password:PROMPT@");
-    string password = receiveInput(sock);
+    return upcomingTrips;
+} // d
 
-     // Hash the password
-    char hash[SHA256_DIGEST_LENGTH * 2 + 1];
-    hash_password(password.c_str(), hash);
 
-    mtx.lock();
-    // writeFile(USER_FILE, {aadhar, name, to_string(age), password});
-    writeFile(USER_FILE, {aadhar, name, to_string(age), string(hash)});
-    mtx.unlock();
-    sendMessage(sock, "✅ Registration Successful!\n");
-} // d
+//------------RESERVE TICKET------------------
+bool validate(string aadhar, string name)
+{
+    Span span("validate");
+    return identities.isRegisteredPassenger(aadhar, name);
+}
 
-//----------USER LOGIN----------------
-string User::login(int sock)
+// Reservation core: the passenger menu and the machine API both price and
+// book through these, so a ticket is the same whichever way it was sold.
+
+// What a ticket on seatNo costs; 10% off when the trip leaves within the hour
+float ticketPrice(const SeatSnapshot &seats, int seatNo, bool discount)
 {
-    sendPrompt(sock, "Enter Your Aadhar Number:PROMPT@");
-    string aadhar = receiveInput(sock);
-    sendPrompt(sock, "Enter Your Password:PROMPT@");
-    string password = receiveInput(sock);
+    float basePrice = seats.price(seatNo);
+    return discount ? basePrice * 0.9f : basePrice;
+}
 
-    // Hash the entered password
-    char hashedPassword[SHA256_DIGEST_LENGTH * 2 + 1];
-    hash_password(password.c_str(), hashedPassword);
+enum BookingOutcome { BOOKING_OK, BOOKING_SEAT_TAKEN, BOOKING_NOT_SAVED };
+
+// co_await CommitRows(rows, &s) -> whether the rows reached the booking log.
+// No worker sits out the fdatasync: the writer thread posts the dialogue's
+// resumption back to its session once the batch is synced. The session (and
+// with it the suspended frame) is kept alive until then. Without a session,
+// as in the benchmarks, the commit is simply waited for.
+class CommitRows
+{
+    const vector<vector<string>> &rows;
+    Session *s;
+    bool saved = false;
 
-    auto users = readFile(USER_FILE);
-    for (auto &row : users)
+public:
+    CommitRows(const vector<vector<string>> &r, Session *session) : rows(r), s(session) {}
+    bool await_ready()
     {
-        if (row.size() < 4)
-            continue;
-        // if (row[0] == aadhar && row[3] == password)
-        if (row[0] == aadhar && row[3] == hashedPassword)
-        {
-            sendMessage(sock, "✅ Login Successful!\n");
-            return aadhar;
-        }
+        if (s)
+            return false;
+        saved = bookingLog.commit(rows).get();
+        return true;
     }
+    void await_suspend(coroutine_handle<> h)
+    {
+        bookingLog.commit(rows, [this, h, self = s->shared_from_this()](bool ok) {
+            saved = ok;
+            self->post([h] { h.resume(); });
+        });
+    }
+    bool await_resume() const { return saved; }
+};
 
-    sendMessage(sock, "❌ Invalid Aadhar number or Password.\n");
-    return "";
-} // d
-
-//------DRIVER CLASS-----------------
-
-void Driver::registerDriver(int sock)
+// Books seatNos[i] at prices[i] for one passenger, all or nothing: the seats
+// are claimed together, and their rows reach the WAL in a single commit
+// before any of them is indexed. On BOOKING_SEAT_TAKEN nothing was booked
+// and takenSeat says which seat was lost; on BOOKING_NOT_SAVED the claimed
+// seats have been given back and nothing was booked either.
+//
+// Seats held by somebody else count as taken. hold is the caller's own hold
+// on these seats, if any (renewed here if it lapsed and the seats are still
+// free); it is released once the seats are booked.
+//
+// The commit suspends the caller's dialogue rather than its worker; bookedBy
+// is the session it resumes on, and is not sent its own seat notice.
+Task<BookingOutcome> bookTickets(const string &tripId, const string &busNo, const vector<int> &seatNos,
+                                 const vector<float> &prices, const string &aadhar, const string &name,
+                                 vector<Booking> &bookings, int &takenSeat, SeatHold &hold,
+                                 Session *bookedBy = nullptr)
 {
+    Span span("bookTickets");
+    if (!seatHolds.hold(tripId, seatNos, hold.id, takenSeat) || !seatStore.bookMany(tripId, seatNos, takenSeat))
+    {
+        metrics.add(METRIC_BOOKINGS_SEAT_TAKEN);
+        co_return BOOKING_SEAT_TAKEN;
+    }
+    hold.reset();
 
-    // Asking for name
-    sendPrompt(sock, "Enter your Name:PROMPT@");
-    string name = receiveInput(sock);
+    time_t timestamp = time(nullptr);
+    char timeBuf[80];
+    strftime(timeBuf, sizeof(timeBuf), "%c", localtime(&timestamp));
 
-    // asking for age
-    int age = 0;
-    while (true)
+    bookings.clear();
+    vector<vector<string>> rows;
+    for (size_t i = 0; i < seatNos.size(); ++i)
     {
-        sendPrompt(sock, "Enter your Age:PROMPT@");
-        string ageinput = receiveInput(sock);
-        try
-        {
-            age = stoi(ageinput);
-            if (age < 25 || age > 60)
-                sendMessage(sock, "Not Eligible to register here as a driver.\n");
-            else
-                break;
-        }
-        catch (invalid_argument &e)
-        {
-            sendMessage(sock, "❌ Invalid input. Please enter a number for age.\n");
-        }
+        bookings.push_back({tripId, busNo, to_string(seatNos[i]), aadhar, name, to_string(prices[i]), timeBuf});
+        rows.push_back(bookings.back().toRow());
+    }
+    bool saved;
+    {
+        MetricTimer timer(METRIC_BOOKING_COMMIT);
+        Span span("BookingLog::commit");
+        saved = co_await CommitRows(rows, bookedBy);
     }
+    if (!saved)
+    {
+        // All or nothing: none of the group was recorded, so none stays claimed
+        seatStore.release(tripId, seatNos);
+        metrics.add(METRIC_BOOKINGS_NOT_SAVED);
+        co_return BOOKING_NOT_SAVED;
+    }
+    metrics.add(METRIC_BOOKINGS_OK);
+    for (auto &b : bookings)
+        bookingIndex.add(b);
+
+    string seatList;
+    for (int seatNo : seatNos)
+        seatList += (seatList.empty() ? "" : ", ") + to_string(seatNo);
+    seatFeed.publish(tripId, "\n🔔 " + tripId + ": seat" + (seatNos.size() > 1 ? "s " : " ") + seatList +
+                                 " just booked (v to refresh the chart)\n", bookedBy);
+    co_return BOOKING_OK;
+}
 
-    // Asking for Aadhar no
-    string aadhar;
-    while (true)
+// "12, 13,14" -> {12, 13, 14}; empty if any entry is not a seat number or repeats
+vector<int> parseSeatList(const string &seatChoice)
+{
+    vector<int> seatNos;
+    for (auto &part : split(seatChoice, ','))
     {
-        sendPrompt(sock, "Enter your Unique Aadhar number:PROMPT@");
-        aadhar = receiveInput(sock);
-        if (!isValidAadhar(aadhar))
-        {
-            sendMessage(sock, "❌ Invalid Aadhar number. It must be 12 digits.\n");
-            continue;
+        int seatNo = parseSeatNo(trim(part));
+        if (seatNo == 0 || find(seatNos.begin(), seatNos.end(), seatNo) != seatNos.end())
+            return {};
+        seatNos.push_back(seatNo);
+    }
+    return seatNos;
+}
+
+Task<> ReservationHandler::reserve(Session &s) {
+
+    while (true) {
+        vector<UpcomingTrip> available = viewTrips(s);
+        if (available.empty()) {
+            s.send("No upcoming buses available\n");
+            co_return;
         }
-        if (isAadharExist(aadhar))
-        {
-            sendPrompt(sock, "This Aadhar number is already registered.\nIs it a Typo error? (y/n): PROMPT@");
-            string ans = receiveInput(sock);
-            if (ans == "y" || ans == "Y")
-            {
-                sendMessage(sock, "No worries, Re-enter again.\n");
-                continue;
+
+        // Build trip list with pricing info
+        string tripOptions = "\n====================================\n"
+                            "         🚌 Upcoming Trips          \n"
+                            "------------------------------------\n\n";
+        unordered_map<string, bool> hasDiscount;
+        vector<string> tripIds;
+        
+        for (size_t i = 0; i < available.size(); ++i) {
+            auto& t = available[i].trip;
+
+            tripOptions += to_string(i+1) + ". " + t.id + " | " + t.busNo + " | " + t.source
+                        + " → " + t.destination + " | " + t.departure +"\n";
+            tripIds.push_back(t.id);
+            hasDiscount[t.id] = available[i].discount;
+        }
+        s.send(tripOptions);
+
+        // Trip selection
+        string currentTripId, busNo;
+        
+        while (true) {
+            try {
+                string input = co_await s.prompt("\nEnter Trip ID (r to refresh trips /e to exit from here): ");
+
+                if (input == "e") {
+                    s.send("Exiting...\n");
+                    co_return;
+                }
+                if (input == "r") break;
+
+                auto it = find(tripIds.begin(), tripIds.end(), input);
+                if (it == tripIds.end()) {
+                    s.send("❌ Invalid Trip ID\n");
+                    continue;
+                }
+
+                currentTripId = input;
+                // Validate trip time and get details
+                for (auto& t : available) {
+                    const Trip &trip = t.trip;
+                    if (trip.id == currentTripId) {
+                        busNo = trip.busNo;
+
+                        // Time validation
+                        if (difftime(trip.departsAt, time(nullptr)) <= 0) {
+                            s.send("⚠️ Trip has departed!\n");
+                            currentTripId.clear();
+                            break;
+                        }
+                        break;
+                    }
+                }
+                if (!currentTripId.empty()) break;
             }
-            else
-            {
-                sendMessage(sock, "You're already registered. Please login instead.\n");
-                return;
+            catch (const invalid_argument&) {
+                s.send("❌ Input cannot be blank!\n");
             }
         }
-        else
-        {
-            break;
+
+        if (currentTripId.empty()) continue;
+
+        // Seat booking, with other passengers' bookings pushed as they happen
+        SeatWatch watch(s, currentTripId);
+        bool returnToTrips = false;
+        while (!returnToTrips) {
+            seatMatrix(currentTripId, s);
+
+            try {
+                string seatChoice = co_await s.prompt("\nChoose seats (c to change trip /e to exit /seat# or seat#,seat#,...): ");
+
+                if (seatChoice == "c") { returnToTrips = true; break; }
+                if (seatChoice == "e") co_return;
+                if (seatChoice == "v") continue;
+
+                // Validate seats
+                SeatSnapshot seats;
+                vector<int> seatNos = parseSeatList(seatChoice);
+                bool validSeats = !seatNos.empty() && seatStore.snapshot(currentTripId, seats);
+                for (int seatNo : seatNos)
+                    validSeats = validSeats && seats.isValidSeat(seatNo) && !seats.isBooked(seatNo);
+
+                if (!validSeats) {
+                    s.send("❌ Invalid/occupied seat\n");
+                    continue;
+                }
+
+                // Keep the seats ours while the passenger fills in the details
+                SeatHold hold;
+                int heldSeat;
+                if (!seatHolds.hold(currentTripId, seatNos, hold.id, heldSeat)) {
+                    s.send("⏳ Seat " + to_string(heldSeat) + " is on hold for another passenger. Try again shortly.\n");
+                    continue;
+                }
+                s.send("⏳ Holding your seat" + string(seatNos.size() > 1 ? "s" : "") + " for "
+                       + to_string(HOLD_SECONDS / 60) + " minutes.\n");
+
+                // Passenger details
+                string name, aadhar;
+              while(true)
+              {
+                        name = co_await s.prompt("Passenger Name:");                     
+              
+                        aadhar = co_await s.prompt("Aadhar Number:");
+                bool registered=validate(aadhar,name);
+                if(registered)break;
+                else
+                s.send("\n ❌ ENTER A REGISTERED USER\n");
+              }
+                // Price calculation
+                bool applyDiscount = hasDiscount[currentTripId];
+                vector<float> prices;
+                float finalPrice = 0;
+                for (int seatNo : seatNos) {
+                    prices.push_back(ticketPrice(seats, seatNo, applyDiscount));
+                    finalPrice += prices.back();
+                }
+                
+                stringstream priceMsg;
+                if (seatNos.size() > 1)
+                    priceMsg << "💺 " << seatNos.size() << " seats: " << seatChoice << "\n";
+                priceMsg << "💰 Final Price: Rs" << fixed << setprecision(2) << finalPrice;
+                if (applyDiscount) {
+                    priceMsg << " (10% discount applied!)";
+                }
+
+                // Confirmation
+                string confirm;
+                while (true) {
+                    confirm = co_await s.prompt(priceMsg.str() + "\nConfirm (y/n): ");
+                    if (confirm == "y" || confirm == "n") break;
+                    s.send("❌ Invalid choice!\n");
+                }
+
+                if (confirm == "y") {
+                    vector<Booking> bookings;
+                    int takenSeat;
+                    BookingOutcome outcome = co_await bookTickets(currentTripId, busNo, seatNos, prices, aadhar, name, bookings, takenSeat, hold, &s);
+                    if (outcome == BOOKING_SEAT_TAKEN) {
+                        s.send("❌ Seat " + to_string(takenSeat) + " is either already booked or invalid. No seats were booked.\n");
+                    }
+                    else if (outcome == BOOKING_NOT_SAVED) {
+                        s.send("❌ The ticket could not be saved. No seats were booked, please try again.\n");
+                    }
+                    else {
+                        s.send(string(bookings.size() > 1 ? "✅ Seats are" : "✅ Seat is") + " being Booked Successfully! " + bookings[0].bookedAt + "\n");
+                        
+                        // Post-booking action
+                        string another;
+                        while (true) {
+                            another = co_await s.prompt("Book another seat? (y/n): ");
+                            if (another == "y" || another == "n") break;
+                            s.send("❌ Invalid input!\n");
+                        }
+
+                        if (another == "n") {
+                            returnToTrips = true;
+                            s.send("Returning to trip selection...\n");
+                        }
+                    }
+                }
+            }
+            catch (const invalid_argument&) {
+                s.send("❌ Input cannot be blank!\n");
+            }
         }
     }
+}
 
-    // Asking for license
-    string license;
+
+
+ 
+//DRIVER CLIENT--------------
+Task<> driver_client(Session &s)
+{
+
+    Driver driver;
     while (true)
     {
-        sendPrompt(sock, "Enter your Unique License number:PROMPT@");
-        license = receiveInput(sock);
-        if (!isValidLicense(license))
+        string choice = co_await s.prompt("\n---------- MAIN MENU ----------\n1. Register\n2. Login\n3. Exit\nChoose: ");
+
+        if (choice == "3")
+            break;
+
+        if (choice == "1")
         {
-            sendMessage(sock, "❌ Invalid License number.\n");
-            continue;
+            co_await driver.registerDriver(s);
+            s.send("Please login to continue...\n");
         }
-        if (isLicenseExist(license))
+
+        string uid = co_await driver.loginDriver(s);
+        if (uid.empty())
+            continue;
+
+        bus_trip_handler handlerbus(uid);
+        while (true)
         {
-            sendPrompt(sock, "This License number is already registered.\nIs it a Typo error? (y/n): PROMPT@");
-            string ans = receiveInput(sock);
-            if (ans == "y" || ans == "Y")
-            {
-                sendMessage(sock, "No worries, Re-enter again.\n");
-                continue;
-            }
+            string action = co_await s.prompt("\n---------- DASHBOARD ----------\n1. Register a bus \n2. Insert a trip\n3. Insert a timetable (bulk)\n4. Logout\nChoose: ");
+            if (action == "1")
+                co_await handlerbus.registerBus(s);
+            else if (action == "2")
+                co_await handlerbus.insertTrip(s);
+            else if (action == "3")
+                co_await handlerbus.insertTimetable(s);
             else
-            {
-                sendMessage(sock, "You're already registered. Please login instead.\n");
-                return;
-            }
-        }
-        else
-        {
-            break;
+                break;
         }
     }
-
-    sendPrompt(sock, "Enter a Strong Password:PROMPT@");
-    string password = receiveInput(sock);
-
-    // Hash the password
-    char hash[SHA256_DIGEST_LENGTH * 2 + 1];
-    hash_password(password.c_str(), hash);
-
-    mtx.lock();
-    writeFile(DRIVER_FILE, {aadhar, license, name, to_string(age), string(hash)});
-    // writeFile(DRIVER_FILE, {aadhar, license, name, to_string(age), password});
-    mtx.unlock();
-    sendMessage(sock, "✅ Registration Successful!\n");
 } // d
 
-//--------------LOGIN DRIVER-----------------
-string trim(const string &s)
-{
-    size_t start = s.find_first_not_of(" \t\n\r");
-    size_t end = s.find_last_not_of(" \t\n\r");
-    if (start == string::npos || end == string::npos)
-        return "";
-    return s.substr(start, end - start + 1);
-}
-string Driver::loginDriver(int sock)
+//----------USER CLIENT----------------
+Task<> handle_client(Session &s)
 {
-    sendPrompt(sock, "Enter Your Aadhar Number:PROMPT@");
-    string aadhar = trim(receiveInput(sock));
+stringstream ss;
+ss << "\n╔══════════════════════════════════════════════════════════╗";
+ss << "\n║                  BUS RESERVATION SYSTEM                  ║";
+ss << "\n╠══════════════════════════════════════════════════════════╣";
+ss << "\n║                    ARE YOU HERE AS A ?                   ║";
+ss << "\n║                                                          ║";
+ss << "\n║              1. PASSENGER   2. BUS DRIVERS               ║";
+ss << "\n╚══════════════════════════════════════════════════════════╝";
+ss << "\n  ENTER YOUR CHOICE :  ";
 
-    sendPrompt(sock, "Enter Your Password:PROMPT@");
-    string password = trim(receiveInput(sock));
+    string c = co_await s.prompt(ss.str()); 
+    if (c == "2")
+    {
+        co_await driver_client(s);
+        co_return; // leaving the driver menu ends the session
+    }
+    User user;
+    while (true)
+    {
+        string choice = co_await s.prompt("\n---------- MAIN MENU ----------\n1. Register\n2. Login\n3. Exit\nChoose: ");
 
-    // Hash the entered password
-    char hashedPassword[SHA256_DIGEST_LENGTH * 2 + 1];
-    hash_password(password.c_str(), hashedPassword);
+        if (choice == "3")
+            break;
 
-    auto users = readFile(DRIVER_FILE);
+        if (choice == "1")
+        {
+            co_await user.registerUser(s);
+            s.send("Please login to continue...\n");
+        }
 
-    for (auto &row : users)
-    {
-        if (row.size() < 5)
+        string uid = co_await user.login(s);
+        if (uid.empty())
             continue;
 
-        string storedAadhar = trim(row[0]);
-        string storedPassword = trim(row[4]);
-
-        if (storedAadhar == aadhar && storedPassword == hashedPassword)
-        // if (storedAadhar == aadhar && storedPassword == password)
+        ReservationHandler handler(uid);
+        while (true)
         {
-            sendMessage(sock, "✅ Login Successful!\n");
-            return storedAadhar;
+            string action = co_await s.prompt("\n---------- DASHBOARD ----------\n1. View Ticket\n2. Reserve Ticket\n3. Logout\nChoose: ");
+            if (action == "1")
+                handler.viewTickets(s);
+            else if (action == "2")
+                co_await handler.reserve(s);
+            else if (action == "3")
+                break;
+            else
+            {
+                s.send("Oops! you mistyped. Try again");
+                continue;
+            }
         }
     }
-
-    sendMessage(sock, "❌ Invalid Aadhar number or Password.\n");
-    return "";
 }
 
-//-------------Insert a Trip(bus_trip_handler)------------------
-// Function to split string by delimiter
-vector<string> split(const string &s, char delimiter)
+// ---------- MACHINE API ----------
+//
+// A second port for travel-agent integrations: one JSON object per line in,
+// one JSON object per line out, in the same order. Every request stands on
+// its own (no login, no menu state), so a client can pipeline as many as it
+// likes without waiting for answers. Instead of logging in, a request that
+// books or reads a passenger's tickets carries that passenger's password,
+// and register_trip the driver's. Operations go through the same
+// reservation core as the passenger and driver menus.
+//
+//   {"op":"search_trips","source":"A","destination":"B","date":"20/12/2027"}
+//   {"op":"get_seat_map","trip_id":"T014"}
+//   {"op":"book_seats","trip_id":"T014","seats":[5,6],"aadhar":"...","password":"...","name":"..."}
+//   {"op":"list_bookings","aadhar":"...","password":"..."}
+//   {"op":"register_trip","driver_aadhar":"...","password":"...","bus":"900",
+//    "source":"A","destination":"B","date":"20/12/2027","time":"10:00","distance":100}
+//
+// Replies carry "ok" and either the result or "error". An "id" field in the
+// request is echoed back untouched.
+
+// Just enough JSON for the API: objects, arrays, strings, numbers, booleans, null
+struct Json
 {
-    vector<string> tokens;
-    string token;
-    istringstream tokenStream(s);
-    while (getline(tokenStream, token, delimiter))
+    enum Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT } type = NUL;
+    bool boolean = false;
+    double number = 0;
+    string text;
+    vector<Json> items;                   // ARRAY
+    vector<pair<string, Json>> fields;    // OBJECT, in document order
+
+    const Json *get(const string &key) const;
+    string str(const string &key) const;  // "" unless key holds a string
+    string dump() const;
+};
+
+string jsonQuote(const string &s)
+{
+    string out = "\"";
+    for (unsigned char c : s)
     {
-        tokens.push_back(token);
+        switch (c)
+        {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (c < 0x20)
+            {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            }
+            else
+                out += char(c);
+        }
     }
-    return tokens;
+    return out + "\"";
 }
 
-// Function to validate date and compare
-bool validateAndCompareDate(const string &departDate, time_t &timestamp, const string &startTime)
+string jsonNumber(double n)
 {
-    vector<string> parts = split(departDate, '/');
-    vector<string> timeParts = split(startTime, ':');
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.15g", n);
+    return buf;
+}
 
-    // Check for proper format
-    if (parts.size() != 3)
-        return false;
+const Json *Json::get(const string &key) const
+{
+    for (auto &f : fields)
+        if (f.first == key)
+            return &f.second;
+    return nullptr;
+}
 
-    int day, month, year, hh, mm;
-    try
+string Json::str(const string &key) const
+{
+    const Json *v = get(key);
+    return v && v->type == STRING ? v->text : "";
+}
+
+string Json::dump() const
+{
+    switch (type)
     {
-        day = stoi(parts[0]);
-        month = stoi(parts[1]);
-        year = stoi(parts[2]);
-        hh = stoi(timeParts[0]);
-        mm = stoi(timeParts[1]);
+    case BOOLEAN: return boolean ? "true" : "false";
+    case NUMBER: return jsonNumber(number);
+    case STRING: return jsonQuote(text);
+    case ARRAY:
+    {
+        string out = "[";
+        for (size_t i = 0; i < items.size(); ++i)
+            out += (i ? "," : "") + items[i].dump();
+        return out + "]";
     }
-    catch (...)
+    case OBJECT:
     {
-        return false; // Non-numeric input
+        string out = "{";
+        for (size_t i = 0; i < fields.size(); ++i)
+            out += (i ? "," : "") + jsonQuote(fields[i].first) + ":" + fields[i].second.dump();
+        return out + "}";
+    }
+    default: return "null";
     }
+}
 
-    // Basic range checks
-    if (month < 1 || month > 12 || day < 1 || day > 31 || year < 1900)
-        return false;
+class JsonParser
+{
+    string_view in;
+    size_t pos = 0;
 
-    // Set up struct tm
-    struct tm datetime = {};
-    datetime.tm_year = year - 1900;
-    datetime.tm_mon = month - 1;
-    datetime.tm_mday = day;
-    datetime.tm_hour = hh;
-    datetime.tm_min = mm;
-    datetime.tm_sec = 0;
-    datetime.tm_isdst = -1;
+    void skipSpace();
+    bool literal(string_view word);
+    bool parseValue(Json &out, int depth);
+    bool parseString(string &out);
+    bool parseNumber(double &out);
 
-    // Convert to time_t
-    timestamp = mktime(&datetime);
-    cout << ctime(&timestamp);
-    if (timestamp == -1)
-        return false; // Invalid timestamp
+public:
+    explicit JsonParser(string_view text) : in(text) {}
+    static bool parse(string_view text, Json &out);
+};
 
-    // Compare with current time
-    time_t now = time(NULL);
-    if (difftime(timestamp, now) < 0)
-    {
-        // Date is in the past
+bool JsonParser::parse(string_view text, Json &out)
+{
+    JsonParser p(text);
+    if (!p.parseValue(out, 0))
         return false;
-    }
-
-    // Valid and in future
-    return true;
+    p.skipSpace();
+    return p.pos == p.in.size();
 }
 
-//-----------INSERT TRIPS----------------
-void bus_trip_handler::insertTrip(int sock)
+void JsonParser::skipSpace()
 {
-    sendPrompt(sock, "Enter Bus Number: PROMPT@");
-    string busNo = receiveInput(sock);
-
-    sendPrompt(sock, "Enter Source: PROMPT@");
-    string source = receiveInput(sock);
-
-    sendPrompt(sock, "Enter Destination: PROMPT@");
-    string destination = receiveInput(sock);
+    while (pos < in.size() && (in[pos] == ' ' || in[pos] == '\t' || in[pos] == '\r' || in[pos] == '\n'))
+        ++pos;
+}
 
-    sendPrompt(sock, "Enter Departure Date (DD/MM/YYYY): PROMPT@");
-    string departDate = receiveInput(sock);
+bool JsonParser::literal(string_view word)
+{
+    if (in.substr(pos, word.size()) != word)
+        return false;
+    pos += word.size();
+    return true;
+}
 
-    sendPrompt(sock, "Enter Start Time (HH:MM): PROMPT@");
-    string startTime = receiveInput(sock);
+bool JsonParser::parseValue(Json &out, int depth)
+{
+    if (depth > 32)
+        return false;
+    skipSpace();
+    if (pos >= in.size())
+        return false;
 
-    sendPrompt(sock,"Enter the Total Distance being covered in KM:PROMPT@");
-    string distance = receiveInput(sock);
-    float dist;
-    try
-        {
-            dist = stof(distance);
-        }
-        catch (invalid_argument &e)
+    char c = in[pos];
+    if (c == '{')
+    {
+        out.type = Json::OBJECT;
+        ++pos;
+        skipSpace();
+        if (pos < in.size() && in[pos] == '}')
+            return ++pos, true;
+        while (true)
         {
-            sendMessage(sock, "❌ Invalid input. Please enter a number\n");
+            skipSpace();
+            string key;
+            Json value;
+            if (!parseString(key))
+                return false;
+            skipSpace();
+            if (pos >= in.size() || in[pos++] != ':')
+                return false;
+            if (!parseValue(value, depth + 1))
+                return false;
+            out.fields.emplace_back(move(key), move(value));
+            skipSpace();
+            if (pos < in.size() && in[pos] == ',')
+                ++pos;
+            else if (pos < in.size() && in[pos] == '}')
+                return ++pos, true;
+            else
+                return false;
         }
-
-    auto buses = readFile("buses.txt");
-    int rows = -1, cols = -1;
-    for (auto &bus : buses)
+    }
+    if (c == '[')
     {
-        if (bus.size() >= 3 && bus[0] == busNo)
+        out.type = Json::ARRAY;
+        ++pos;
+        skipSpace();
+        if (pos < in.size() && in[pos] == ']')
+            return ++pos, true;
+        while (true)
         {
-            rows = stoi(bus[2]);
-            cols = stoi(bus[3]);
-            break;
+            Json value;
+            if (!parseValue(value, depth + 1))
+                return false;
+            out.items.push_back(move(value));
+            skipSpace();
+            if (pos < in.size() && in[pos] == ',')
+                ++pos;
+            else if (pos < in.size() && in[pos] == ']')
+                return ++pos, true;
+            else
+                return false;
         }
     }
-    time_t timestamp;
-    string departure = "";
-    if (validateAndCompareDate(departDate, timestamp, startTime) == false)
+    if (c == '"')
     {
-        sendMessage(sock, "❌ Departure date or time invalid.\n");
-        return;
+        out.type = Json::STRING;
+        return parseString(out.text);
     }
-    else
+    if (literal("true"))
     {
-
-        departure = ctime(&timestamp);
-        if (!departure.empty() && departure.back() == '\n')
-        {
-            departure.pop_back();
-        }
+        out.type = Json::BOOLEAN;
+        out.boolean = true;
+        return true;
+    }
+    if (literal("false"))
+    {
+        out.type = Json::BOOLEAN;
+        return true;
     }
+    if (literal("null"))
+        return true;
 
-    if (rows <= 0 || cols <= 0)
+    out.type = Json::NUMBER;
+    return parseNumber(out.number);
+}
+
+// Appends code point cp to out as UTF-8
+static void appendUtf8(string &out, uint32_t cp)
+{
+    if (cp < 0x80)
+        out += char(cp);
+    else if (cp < 0x800)
     {
-        sendMessage(sock, "❌ Bus not found or invalid seat dimensions.\n");
-        return;
+        out += char(0xC0 | (cp >> 6));
+        out += char(0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000)
+    {
+        out += char(0xE0 | (cp >> 12));
+        out += char(0x80 | ((cp >> 6) & 0x3F));
+        out += char(0x80 | (cp & 0x3F));
     }
+    else
+    {
+        out += char(0xF0 | (cp >> 18));
+        out += char(0x80 | ((cp >> 12) & 0x3F));
+        out += char(0x80 | ((cp >> 6) & 0x3F));
+        out += char(0x80 | (cp & 0x3F));
+    }
+}
 
-    auto trips = readFile("trips.txt");
-    for (auto &trip : trips)
+bool JsonParser::parseString(string &out)
+{
+    if (pos >= in.size() || in[pos] != '"')
+        return false;
+    ++pos;
+
+    auto hex4 = [this](uint32_t &cp) {
+        cp = 0;
+        if (pos + 4 > in.size())
+            return false;
+        auto r = from_chars(in.data() + pos, in.data() + pos + 4, cp, 16);
+        if (r.ptr != in.data() + pos + 4)
+            return false;
+        pos += 4;
+        return true;
+    };
+
+    while (pos < in.size())
     {
-        if (trip.size() == 7 && trip[1] == busNo)
+        char c = in[pos++];
+        if (c == '"')
+            return true;
+        if (c != '\\')
         {
-            string existingDateTime = trip[6];
-        string existingDate = extractDateDDMMYYYY(existingDateTime);
-
-        if (existingDate == departDate)
+            out += c;
+            continue;
+        }
+        if (pos >= in.size())
+            return false;
+        switch (in[pos++])
         {
-            string existingTime = extractTime(existingDateTime);  // "HH:MM"
-            
-            if (!isTimeDifferenceSafe(existingTime, startTime))
+        case '"': out += '"'; break;
+        case '\\': out += '\\'; break;
+        case '/': out += '/'; break;
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'u':
+        {
+            uint32_t cp;
+            if (!hex4(cp))
+                return false;
+            // Surrogate pair
+            if (cp >= 0xD800 && cp < 0xDC00 && in.substr(pos, 2) == "\\u")
             {
-                sendPrompt(sock, "❌ A trip with this bus is already scheduled on the same date within 60 minutes.\n");
-                return;
+                pos += 2;
+                uint32_t low;
+                if (!hex4(low) || low < 0xDC00 || low > 0xDFFF)
+                    return false;
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
             }
+            appendUtf8(out, cp);
+            break;
         }
+        default:
+            return false;
         }
     }
+    return false;
+}
 
-    string tripID = generateTripID();
-
-    mtx.lock();
-    writeFile(TRIPS_FILE, {tripID, busNo, source, destination, distance, aadhar, departure});
-    mtx.unlock();
-    // creating seat file (rows and cols are int)
-    createSeatFile(tripID, rows, cols,dist);
-
-    sendMessage(sock, "✅ A Trip is being inserted successfully with Trip ID " + tripID + "\n");
-} // d
+bool JsonParser::parseNumber(double &out)
+{
+    size_t start = pos;
+    while (pos < in.size() && (isdigit((unsigned char)in[pos]) || strchr("+-.eE", in[pos])))
+        ++pos;
+    if (pos == start)
+        return false;
+    auto r = from_chars(in.data() + start, in.data() + pos, out);
+    return r.ec == errc() && r.ptr == in.data() + pos;
+}
 
-//-----------Register a bus-------------
-void bus_trip_handler::registerBus(int sock)
+// Builds one reply object: JsonObject().addBool("ok", true).addString("trip_id", id).str()
+class JsonObject
 {
-    sendPrompt(sock, "Enter Bus Number (unique ID): PROMPT@");
-    string busNo = receiveInput(sock);
+    string out = "{";
 
-    // Check if busNo already exists
-    auto buses = readFile("buses.txt");
-    for (auto &b : buses)
+    JsonObject &key(const string &k)
     {
-        if (!b.empty() && b[0] == busNo)
-        {
-            sendPrompt(sock, "❌ Bus Number already registered.\n");
-            return;
-        }
+        if (out.size() > 1)
+            out += ',';
+        out += jsonQuote(k) + ":";
+        return *this;
     }
 
-    // Get rows
-    sendPrompt(sock, "Enter number of seat rows: PROMPT@");
-    string rowStr = receiveInput(sock);
-
-    // Get columns
-    sendPrompt(sock, "Enter number of seat columns: PROMPT@");
-    string colStr = receiveInput(sock);
-
-    // Validate inputs
-    try
-    {
-        int rows = stoi(rowStr);
-        int cols = stoi(colStr);
-
-        if (rows <= 0 || cols <= 0)
-        {
-            sendMessage(sock, "❌ Invalid row or column count for a bus\n");
-            return;
-        }
-
-        mtx.lock();
-        writeFile("buses.txt", {busNo, aadhar, rowStr, colStr});
-        mtx.unlock();
-
-        sendMessage(sock, "✅ Bus registered successfully.\n");
-    }
-    catch (...)
-    {
-        sendPrompt(sock, "❌ Invalid input. Please enter numeric values.\n");
-    }
-} // d
+public:
+    JsonObject &addString(const string &k, const string &v) { key(k).out += jsonQuote(v); return *this; }
+    JsonObject &addNumber(const string &k, double v) { key(k).out += jsonNumber(v); return *this; }
+    JsonObject &addBool(const string &k, bool v) { key(k).out += v ? "true" : "false"; return *this; }
+    JsonObject &addRaw(const string &k, const string &json) { key(k).out += json; return *this; }
+    string str() const { return out + "}"; }
+};
 
-//-----------RESERVATION HANDLER-----------------
+string jsonArray(const vector<string> &items)
+{
+    string out = "[";
+    for (size_t i = 0; i < items.size(); ++i)
+        out += (i ? "," : "") + items[i];
+    return out + "]";
+}
 
-//-------------VIEW TICKETS----------
-void ReservationHandler::viewTickets(int sock)
+// A request field that may be sent as either a string or a number
+string textField(const Json &req, const string &key)
 {
-    // auto bookings = readFile("bookings.txt");
-    // string response = "🧾 Your Bookings:\n";
-    // int count = 0;
+    const Json *v = req.get(key);
+    if (v && v->type == Json::NUMBER)
+        return jsonNumber(v->number);
+    return v && v->type == Json::STRING ? v->text : "";
+}
 
-    // for (auto &b : bookings)
-    // {
-    //     if (b.size() >= 5 && b[3] == uid)
-    //     {
-    //         response += to_string(++count) + ". Trip ID: " + b[0] + ",Bus No:" + b[1] + ", Seat No: " + b[2] + "\n";
-    //     }
-    // }
+const char *const SEAT_CLASS_NAMES[] = {"window", "middle", "back_window", "back_middle"};
 
-    // if (count == 0)
-    // {
-    //     response = "❌ No bookings found under your ID.\n";
-    // }
+string tripJson(const Trip &t, bool discount)
+{
+    return JsonObject()
+        .addString("trip_id", t.id)
+        .addString("bus", t.busNo)
+        .addString("source", t.source)
+        .addString("destination", t.destination)
+        .addString("distance", t.distance)
+        .addString("departure", t.departure)
+        .addNumber("departs_at", t.departsAt)
+        .addBool("discount", discount)
+        .str();
+}
 
-    // sendPrompt(sock, response);
-    auto bookings = readFile("bookings.txt");
-    auto trips = readFile("trips.txt");
+// Each handler fills in the result fields, or returns false with error set
 
-    string response = "🎫 Your Booked Tickets:\n\n";
-    int count = 0;
+bool apiSearchTrips(const Json &req, JsonObject &res, string & /* error: searching cannot fail */)
+{
+    string source = req.str("source"), destination = req.str("destination"), date = req.str("date");
 
-    for (auto &b : bookings)
+    vector<string> trips;
+    for (auto &u : tripStore.upcoming(time(nullptr)))
     {
-        if (b.size() >= 7 && b[3] == uid)
-        {
-            string tripID = b[0];
-            string busNo = b[1];
-            string seatNo = b[2];
-            string maskedAadhar = string(b[3].length() - 4, 'X') + b[3].substr(b[3].length() - 4);
-            string username = b[4];
-            string price = b[5];
-            string bookingTime = b[6];
-
-            // Find the corresponding trip from trips.txt
-            vector<string> tripInfo;
-            for (auto &t : trips)
-            {
-                if (t.size() >= 7 && t[0] == tripID)
-                {
-                    tripInfo = t;
-                    break;
-                }
-            }
-
-            if (tripInfo.empty())
-                continue; // Skip if no matching trip found
-
-            string source = tripInfo[2];
-            string destination = tripInfo[3];
-            string departure = tripInfo[6];
-
-            response += "-----------------------------------------\n";
-            response += "🚌 Ticket #" + to_string(++count) + "\n";
-            response += "Trip ID       : " + tripID + "\n";
-            response += "Bus Number    : " + busNo + "\n";
-            response += "Seat Number   : " + seatNo + "\n";
-            response += "Name          : " + username + "\n";
-            response += "Aadhar Number : " + maskedAadhar + "\n";
-            response += "Ticket Price  : ₹" + price + "\n";
-            response += "Booking Time  : " + bookingTime + "\n";
-            response += "-----------------------------------------\n";
-            response += "Route         : " + source + " ➡ " + destination + "\n";
-            response += "Departure Date: " + departure + "\n";
-            response += "=========================================\n\n";
-        }
+        if (!source.empty() && !equalsIgnoreCase(u.trip.source, source))
+            continue;
+        if (!destination.empty() && !equalsIgnoreCase(u.trip.destination, destination))
+            continue;
+        if (!date.empty() && extractDateDDMMYYYY(u.trip.departure) != date)
+            continue;
+        trips.push_back(tripJson(u.trip, u.discount));
     }
+    res.addRaw("trips", jsonArray(trips));
+    return true;
+}
 
-    if (count == 0)
+bool apiGetSeatMap(const Json &req, JsonObject &res, string &error)
+{
+    Trip trip;
+    SeatSnapshot seats;
+    if (!tripStore.find(req.str("trip_id"), trip) || !seatStore.snapshot(trip.id, seats))
     {
-        response = "❌ No bookings found under your ID.\n";
+        error = "unknown trip_id";
+        return false;
     }
+    bool discount = lastHourDiscount(trip.departsAt, time(nullptr));
 
-    sendMessage(sock, response);
+    vector<string> seatList;
+    for (int seatNo = 1; seatNo <= seats.seatCount(); ++seatNo)
+    {
+        seatList.push_back(JsonObject()
+                               .addNumber("seat", seatNo)
+                               .addString("class", SEAT_CLASS_NAMES[seatClassOf(seatNo - 1, seats.rows, seats.cols)])
+                               .addNumber("price", ticketPrice(seats, seatNo, discount))
+                               .addBool("booked", seats.isBooked(seatNo))
+                               .str());
+    }
+    res.addString("trip_id", trip.id)
+        .addNumber("rows", seats.rows)
+        .addNumber("cols", seats.cols)
+        .addBool("discount", discount)
+        .addRaw("seats", jsonArray(seatList));
+    return true;
 }
 
-//-----------VIEW TRIPS--------------
-vector<vector<string>> ReservationHandler::viewTrips(int sock)
+// What the menu's login checks, for a request that acts for the passenger
+bool passengerPassword(const Json &req, const string &aadhar)
 {
-    auto trips = readFile(TRIPS_FILE);
-    vector<vector<string>> upcomingTrips;
-
-    // Get current time
-    auto now = chrono::system_clock::now();
-    time_t now_time = chrono::system_clock::to_time_t(now);
-    tm now_tm = *localtime(&now_time);
-    int currentMinutes = now_tm.tm_hour * 60 + now_tm.tm_min;
+    char hashedPassword[SHA256_DIGEST_LENGTH * 2 + 1];
+    hash_password(req.str("password").c_str(), hashedPassword);
+    return identities.checkUserPassword(aadhar, hashedPassword);
+}
 
-    // Format: TripID, BusNo, Source, Destination, StartTime, DriverName
-    for (auto &trip : trips)
+// Suspends the API session while the booking log syncs
+Task<bool> apiBookSeats(Session &s, const Json &req, JsonObject &res, string &error)
+{
+    string aadhar = req.str("aadhar"), name = req.str("name");
+    const Json *seatField = req.get("seats");
+    if (!passengerPassword(req, aadhar))
     {
-        // if (trip.size() == 6 && isTimeAfterNow(trip[4]))
-        // {
-        //     // Calculate time difference
-        //     int tripMinutes = timeToMinutes(trip[4]);
-        //     int timeDiff = tripMinutes - currentMinutes;
-
-        //     // Add pricing indicator if less than 1 hour remains
-        //     if (timeDiff <= 60 && timeDiff > 0)
-        //     {
-        //         trip.push_back("⚠️ Less than 1 hour left! Price Decreased - Book Now!");
-        //     }
-        //     upcomingTrips.push_back(trip);
-        // }
-        if (trip.size() != 7)
-            continue;
-
-        string dateTimeStr = trip[6];
-
-        if (isDateTimeAfterNow(dateTimeStr))
-        {
-            time_t tripTime = getTimeFromDateTime(dateTimeStr);
-            // int tripMinutes = getMinutesFromDateTime(dateTimeStr);
-            // int timeDiff = tripMinutes - currentMinutes;
-            // cout << timeDiff << endl;
-            // if (timeDiff <= 60 && timeDiff > 0)
-            time_t nowTime = time(nullptr);
-            int timeDiffMinutes = difftime(tripTime, nowTime) / 60;
-
-            cout << "Time diff (mins): " << timeDiffMinutes << endl;
+        error = "invalid aadhar or password";
+        co_return false;
+    }
 
-            if (timeDiffMinutes <= 60 && timeDiffMinutes > 0)
-            {
-                
-                trip[6] += " [ DISCOUNT-⚠️ Less than 1 hour left! Price Decreased - Hurry!]";
-            }
+    Trip trip;
+    SeatSnapshot seats;
+    if (!tripStore.find(req.str("trip_id"), trip) || !seatStore.snapshot(trip.id, seats))
+    {
+        error = "unknown trip_id";
+        co_return false;
+    }
+    time_t now = time(nullptr);
+    if (difftime(trip.departsAt, now) <= 0)
+    {
+        error = "trip has departed";
+        co_return false;
+    }
+    if (!validate(aadhar, name))
+    {
+        error = "aadhar and name must belong to a registered passenger";
+        co_return false;
+    }
+    if (!seatField || seatField->type != Json::ARRAY || seatField->items.empty())
+    {
+        error = "seats must be a non-empty array of seat numbers";
+        co_return false;
+    }
 
-            upcomingTrips.push_back(trip);
+    vector<int> seatNos;
+    for (auto &item : seatField->items)
+    {
+        // Range-checked before the cast: converting 1e10 or NaN to int is undefined
+        bool whole = item.type == Json::NUMBER && isfinite(item.number) && item.number == floor(item.number) &&
+                     item.number >= 1 && item.number <= MAX_SEATS;
+        int seatNo = whole ? int(item.number) : 0;
+        if (!whole || !seats.isValidSeat(seatNo))
+        {
+            error = "invalid seat " + item.dump();
+            co_return false;
+        }
+        if (find(seatNos.begin(), seatNos.end(), seatNo) != seatNos.end())
+        {
+            error = "seat " + to_string(seatNo) + " requested twice";
+            co_return false;
         }
+        seatNos.push_back(seatNo);
     }
 
-    if (upcomingTrips.empty())
+    bool discount = lastHourDiscount(trip.departsAt, now);
+    vector<float> prices;
+    for (int seatNo : seatNos)
+        prices.push_back(ticketPrice(seats, seatNo, discount));
+
+    vector<Booking> bookings;
+    int takenSeat;
+    SeatHold hold;
+    BookingOutcome outcome = co_await bookTickets(trip.id, trip.busNo, seatNos, prices, aadhar, name, bookings, takenSeat, hold, &s);
+    if (outcome == BOOKING_SEAT_TAKEN)
     {
-        sendMessage(sock, "❌ No upcoming trips are available.\n");
+        res.addNumber("seat", takenSeat);
+        error = "seat " + to_string(takenSeat) + " is booked or on hold; no seats were booked";
+        co_return false;
+    }
+    if (outcome == BOOKING_NOT_SAVED)
+    {
+        error = "the booking could not be saved; no seats were booked";
+        co_return false;
     }
 
-    return upcomingTrips;
-} // d
-
+    vector<string> booked;
+    for (auto &b : bookings)
+        booked.push_back(JsonObject()
+                             .addNumber("seat", stoi(b.seatNo))
+                             .addNumber("price", stod(b.price))
+                             .addString("booked_at", b.bookedAt)
+                             .str());
+    res.addString("trip_id", trip.id).addRaw("booked", jsonArray(booked));
+    co_return true;
+}
 
-//------------RESERVE TICKET------------------
-bool validate(string aadhar, string name)
+bool apiListBookings(const Json &req, JsonObject &res, string &error)
 {
- bool registered = false;
-     auto users = readFile(USER_FILE);
-         for (auto &user : users)
-          {
-           if (user.size() >= 2 && user[0] == aadhar && equalsIgnoreCase(user[1],name))
-                {
-                  registered = true;
-                  break;
-                 }
-          }
-    return registered;
-}
+    string aadhar = req.str("aadhar");
+    if (!passengerPassword(req, aadhar))
+    {
+        error = "invalid aadhar or password";
+        return false;
+    }
 
-void ReservationHandler::reserve(int sock) {
+    vector<string> bookings;
+    for (auto &b : bookingIndex.forPassenger(aadhar))
+    {
+        Trip trip;
+        JsonObject o;
+        o.addString("trip_id", b.tripId)
+            .addString("bus", b.busNo)
+            .addString("seat", b.seatNo)
+            .addString("name", b.name)
+            .addString("price", b.price)
+            .addString("booked_at", b.bookedAt);
+        if (tripStore.find(b.tripId, trip))
+            o.addString("source", trip.source).addString("destination", trip.destination).addString("departure", trip.departure);
+        bookings.push_back(o.str());
+    }
+    res.addRaw("bookings", jsonArray(bookings));
+    return true;
+}
 
-    while (true) {
-        vector<vector<string>> available = viewTrips(sock);
-        if (available.empty()) {
-            sendMessage(sock, "No upcoming buses available\n");
-            return;
-        }
+bool apiRegisterTrip(const Json &req, JsonObject &res, string &error)
+{
+    string driver = req.str("driver_aadhar");
+    char hashedPassword[SHA256_DIGEST_LENGTH * 2 + 1];
+    hash_password(req.str("password").c_str(), hashedPassword);
+    if (!identities.checkDriverPassword(driver, hashedPassword))
+    {
+        error = "invalid driver_aadhar or password";
+        return false;
+    }
 
-        // Build trip list with pricing info
-        string tripOptions = "\n====================================\n"
-                            "         🚌 Upcoming Trips          \n"
-                            "------------------------------------\n\n";
-        unordered_map<string, bool> hasDiscount;
-        vector<string> tripIds;
-        
-        for (size_t i = 0; i < available.size(); ++i) {
-            auto& t = available[i];
-            string priceNote = "";
-            bool discount = false;
-            if (t.size() == 7 && t[6].find("DISCOUNT") != string::npos) 
-            discount = true;
-            
-            tripOptions += to_string(i+1) + ". " + t[0] + " | " + t[1] + " | " + t[2] 
-                        + " → " + t[3] + " | " + t[6] +"\n";
-            tripIds.push_back(t[0]);
-            hasDiscount[t[0]] = discount;
-        }
-        sendMessage(sock, tripOptions);
+    string tripID = scheduleTrip(driver, textField(req, "bus"), req.str("source"), req.str("destination"),
+                                 req.str("date"), req.str("time"), textField(req, "distance"), error);
+    if (tripID.empty())
+        return false;
 
-        // Trip selection
-        string currentTripId, busNo;
-        int rows = 0, cols = 0;
-        
-        while (true) {
-            try {
-                sendPrompt(sock, "\nEnter Trip ID (r to refresh trips /e to exit from here): PROMPT@");
-                string input = receiveInput(sock);
+    Trip trip;
+    tripStore.find(tripID, trip);
+    res.addRaw("trip", tripJson(trip, lastHourDiscount(trip.departsAt, time(nullptr))));
+    return true;
+}
 
-                if (input == "e") {
-                    sendMessage(sock, "Exiting...\n");
-                    return;
-                }
-                if (input == "r") break;
+// An op that never has to wait, in the shape of one that might
+template <bool (*op)(const Json &, JsonObject &, string &)>
+Task<bool> immediate(Session &, const Json &req, JsonObject &res, string &error)
+{
+    co_return op(req, res, error);
+}
 
-                auto it = find(tripIds.begin(), tripIds.end(), input);
-                if (it == tripIds.end()) {
-                    sendMessage(sock, "❌ Invalid Trip ID\n");
-                    continue;
-                }
+// One request line in, one reply line out
+Task<string> handleApiRequest(Session &s, const string &line)
+{
+    Span span("handleApiRequest");
+    Json req;
+    if (!JsonParser::parse(line, req) || req.type != Json::OBJECT)
+        co_return JsonObject().addBool("ok", false).addString("error", "request must be one JSON object per line").str();
+
+    using Handler = Task<bool> (*)(Session &, const Json &, JsonObject &, string &);
+    static const unordered_map<string, Handler> handlers = {
+        {"search_trips", immediate<apiSearchTrips>},
+        {"get_seat_map", immediate<apiGetSeatMap>},
+        {"book_seats", apiBookSeats},
+        {"list_bookings", immediate<apiListBookings>},
+        {"register_trip", immediate<apiRegisterTrip>},
+    };
 
-                currentTripId = input;
-                // Validate trip time and get details
-                for (auto& trip : available) {
-                    if (trip[0] == currentTripId) {
-                        busNo = trip[1];
-                        string datetimeStr = trip[6];
-                        
-                        // Time validation
-                        tm tripTm = {};
-                        istringstream ss(datetimeStr);
-                        ss >> get_time(&tripTm, "%a %b %d %H:%M:%S %Y");
-                        time_t tripTime = mktime(&tripTm);
-                        
-                        if (difftime(tripTime, time(nullptr)) <= 0) {
-                            sendMessage(sock, "⚠️ Trip has departed!\n");
-                            currentTripId.clear();
-                            break;
-                        }
-                        
-                        // Get bus layout
-                        auto buses = readFile(BUS_FILE);
-                        for (auto& b : buses) {
-                            if (b.size() >= 4 && b[0] == busNo) {
-                                rows = stoi(b[2]);
-                                cols = stoi(b[3]);
-                                break;
-                            }
-                        }
-                        break;
-                    }
-                }
-                if (!currentTripId.empty()) break;
-            }
-            catch (const invalid_argument&) {
-                sendMessage(sock, "❌ Input cannot be blank!\n");
-            }
-        }
+    JsonObject result;
+    string error;
+    string op = req.str("op");
+    auto handler = handlers.find(op);
+    bool ok;
+    if (handler == handlers.end())
+    {
+        ok = false;
+        error = "unknown op '" + op + "'";
+    }
+    else
+        ok = co_await handler->second(s, req, result, error);
+
+    JsonObject reply;
+    if (const Json *id = req.get("id"))
+        reply.addRaw("id", id->dump());
+    reply.addBool("ok", ok);
+    if (!ok)
+        reply.addString("error", error);
+    // Splice the result fields in after "ok"/"error"
+    string head = reply.str(), body = result.str();
+    if (body.size() > 2)
+        head.replace(head.size() - 1, 1, "," + body.substr(1));
+    co_return head;
+}
 
-        if (currentTripId.empty()) continue;
+//----------MACHINE API CLIENT----------------
+Task<> api_client(Session &s)
+{
+    while (true)
+    {
+        string request = co_await s.next();
+        s.send(co_await handleApiRequest(s, request) + "\n");
+    }
+}
 
-        // Seat booking
-        bool returnToTrips = false;
-        while (!returnToTrips) {
-            seatMatrix(currentTripId, rows, cols, sock);
+// ---------- ADMIN PORT ----------
+//
+// Loopback only. Prometheus (or curl) sends "GET /metrics HTTP/1.1" and gets
+// the metrics back over HTTP; any other first line, including a blank one,
+// gets the bare text, so `echo | nc localhost 8052` works too. One answer
+// per connection, either "GET <path> HTTP/1.x" or a bare command line. "locks" (or /locks) prints the lock profile instead of the
+// metrics, and "locks reset" (/locks?reset) also starts a new window.
+// "spans on" / "spans off" (/spans?on, /spans?off) switch span tracing, and
+// "spans" (/spans) exports the recorded spans as Chrome trace JSON.
+const size_t LOCK_REPORT_SITES = 20;
+
+Task<> admin_client(Session &s)
+{
+    string request = co_await s.next();
+    bool http = request.rfind("GET ", 0) == 0;
+    string target = http ? request.substr(4, request.find(' ', 4) - 4) : request;
+    while (!target.empty() && isspace((unsigned char)target.back()))
+        target.pop_back();
+
+    bool locks = target == "locks" || target == "/locks";
+    bool reset = target == "locks reset" || target == "/locks?reset";
+    bool spansOn = target == "spans on" || target == "/spans?on";
+    bool spansOff = target == "spans off" || target == "/spans?off";
+
+    string body, type = "text/plain";
+    if (locks || reset)
+        body = lockProfiler.report(LOCK_REPORT_SITES, reset);
+    else if (spansOn || spansOff)
+    {
+        spans.enable(spansOn);
+        body = string("Span tracing ") + (spansOn ? "on" : "off") + "\n";
+    }
+    else if (target == "spans" || target == "/spans")
+    {
+        body = spans.exportJson();
+        type = "application/json";
+    }
+    else
+    {
+        body = metrics.render();
+        type = "text/plain; version=0.0.4";
+    }
 
-            try {
-                sendPrompt(sock, "\nChoose seat (c to change trip /e to exit /seat#): PROMPT@");
-                string seatChoice = receiveInput(sock);
+    if (http)
+        s.send("HTTP/1.0 200 OK\r\nContent-Type: " + type + "\r\nContent-Length: " +
+               to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body);
+    else
+        s.send(body);
+}
 
-                if (seatChoice == "c") { returnToTrips = true; break; }
-                if (seatChoice == "e") return;
-                if (seatChoice == "v") continue;
+// --- MAIN ---
 
-                // Validate seat
-                auto seatData = readFile("seat" + currentTripId + ".txt");
-                bool validSeat = false;
-                float basePrice = 0.0f;
-                
-                for (auto& seat : seatData) {
-                    if (seat.size() >= 3 && seat[0] == seatChoice && seat[1] == "0") {
-                        validSeat = true;
-                        basePrice = stof(seat[2]);
-                        break;
-                    }
-                }
+// ---------- Event Loop ----------
+// Single epoll thread: accepts, reads and finishes partial writes. Session
+// work goes to the worker pool, so this thread never blocks on a client.
+class Reactor
+{
+public:
+    using Dialogue = Task<> (*)(Session &);
 
-                if (!validSeat) {
-                    sendMessage(sock, "❌ Invalid/occupied seat\n");
-                    continue;
-                }
+private:
+    struct Listener
+    {
+        Dialogue dialogue;          // what its clients get
+        bool blankLines;            // empty lines reach the dialogue instead of being skipped
+    };
 
-                // Passenger details
-                string name, aadhar;
-              while(true)
-              {
-                        sendPrompt(sock, "Passenger Name:PROMPT@");
-                        name = receiveInput(sock);                     
-              
-                        sendPrompt(sock, "Aadhar Number:PROMPT@");
-                        aadhar = receiveInput(sock);
-                bool registered=validate(aadhar,name);
-                if(registered)break;
-                else
-                sendMessage(sock,"\n ❌ ENTER A REGISTERED USER\n");
-              }
-                // Price calculation
-                bool applyDiscount = hasDiscount[currentTripId];
-                float finalPrice = applyDiscount ? basePrice * 0.9f : basePrice;
-                
-                stringstream priceMsg;
-                priceMsg << "💰 Final Price: Rs" << fixed << setprecision(2) << finalPrice;
-                if (applyDiscount) {
-                    priceMsg << " (10% discount applied!)";
-                }
+    int epfd = -1;
+    unordered_map<int, Listener> listeners;   // listening socket -> how its clients are served
+    unordered_map<int, shared_ptr<Session>> sessions;
 
-                // Confirmation
-                string confirm;
-                while (true) {
-                    sendPrompt(sock, priceMsg.str() + "\nConfirm (y/n): PROMPT@");
-                    confirm = receiveInput(sock);
-                    if (confirm == "y" || confirm == "n") break;
-                    sendMessage(sock, "❌ Invalid choice!\n");
-                }
+    void acceptClients(int listenFd, const Listener &listener);
+    void drop(int fd);
 
-                if (confirm == "y") {
-                    time_t timestamp = time(nullptr);
-                    if (bookSeat(sock, currentTripId, seatChoice, aadhar, name)) {
-                        char timeBuf[80];
-                        strftime(timeBuf, sizeof(timeBuf), "%c", localtime(&timestamp));
-                        
-                        vector<string> booking = {
-                            currentTripId, busNo, seatChoice, 
-                            aadhar, name, to_string(finalPrice), timeBuf
-                        };
-                        writeFile(BOOKING_FILE, booking);
-                        
-                        sendMessage(sock, "✅ Seat is being Booked Successfully! " + string(timeBuf) + "\n");
-                        
-                        // Post-booking action
-                        string another;
-                        while (true) {
-                            sendPrompt(sock, "Book another seat? (y/n): PROMPT@");
-                            another = receiveInput(sock);
-                            if (another == "y" || another == "n") break;
-                            sendMessage(sock, "❌ Invalid input!\n");
-                        }
+public:
+    bool open();
+    bool listen(int listenFd, Dialogue dialogue, bool blankLines = false);
+    void run();
+};
 
-                        if (another == "n") {
-                            returnToTrips = true;
-                            sendMessage(sock, "Returning to trip selection...\n");
-                        }
-                    }
-                }
-            }
-            catch (const invalid_argument&) {
-                sendMessage(sock, "❌ Input cannot be blank!\n");
-            }
-        }
+bool Reactor::open()
+{
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0)
+    {
+        logger.log(LOG_ERROR, string("❌ epoll_create1: ") + strerror(errno));
+        return false;
     }
+    return true;
 }
 
-
-
- 
-//DRIVER CLIENT--------------
-void driver_client(int sock)
+// Serve every client accepted on listenFd with dialogue
+bool Reactor::listen(int listenFd, Dialogue dialogue, bool blankLines)
 {
+    fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL) | O_NONBLOCK);
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = listenFd;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, listenFd, &ev) < 0)
+    {
+        logger.log(LOG_ERROR, string("❌ epoll_ctl: ") + strerror(errno));
+        return false;
+    }
+    listeners[listenFd] = {dialogue, blankLines};
+    return true;
+}
 
-    Driver driver;
+void Reactor::run()
+{
+    epoll_event events[256];
     while (true)
     {
-        sendPrompt(sock, "\n---------- MAIN MENU ----------\n1. Register\n2. Login\n3. Exit\nChoose: PROMPT@");
-        string choice = receiveInput(sock);
-
-        if (choice == "3")
-            break;
-
-        if (choice == "1")
+        int n = epoll_wait(epfd, events, 256, -1);
+        if (n < 0)
         {
-            driver.registerDriver(sock);
-            sendMessage(sock, "Please login to continue...\n");
+            if (errno == EINTR)
+                continue;
+            logger.log(LOG_ERROR, string("❌ epoll_wait: ") + strerror(errno));
+            return;
         }
 
-        string uid = driver.loginDriver(sock);
-        if (uid.empty())
-            continue;
-
-        bus_trip_handler handlerbus(uid);
-        while (true)
+        for (int i = 0; i < n; ++i)
         {
-            sendPrompt(sock, "\n---------- DASHBOARD ----------\n1. Register a bus \n2. Insert a trip\n3. Logout\nChoose: PROMPT@");
-            string action = receiveInput(sock);
-            if (action == "1")
-                handlerbus.registerBus(sock);
-            else if (action == "2")
-                handlerbus.insertTrip(sock);
-            else
-                break;
+            int fd = events[i].data.fd;
+            auto listener = listeners.find(fd);
+            if (listener != listeners.end())
+            {
+                acceptClients(fd, listener->second);
+                continue;
+            }
+
+            auto it = sessions.find(fd);
+            if (it == sessions.end())
+                continue;
+            shared_ptr<Session> session = it->second;
+
+            if (events[i].events & EPOLLOUT)
+                session->writable();
+            if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !session->readable())
+                drop(fd);
         }
     }
-    close(sock);
-} // d
+}
 
-//----------USER CLIENT----------------
-void handle_client(int sock)
+void Reactor::acceptClients(int listenFd, const Listener &listener)
 {
-stringstream ss;
-ss << "\n╔══════════════════════════════════════════════════════════╗";
-ss << "\n║                  BUS RESERVATION SYSTEM                  ║";
-ss << "\n╠══════════════════════════════════════════════════════════╣";
-ss << "\n║                    ARE YOU HERE AS A ?                   ║";
-ss << "\n║                                                          ║";
-ss << "\n║              1. PASSENGER   2. BUS DRIVERS               ║";
-ss << "\n╚══════════════════════════════════════════════════════════╝";
-ss << "\n  ENTER YOUR CHOICE :  PROMPT@";
-
-    sendPrompt(sock,ss.str());
-    string c = receiveInput(sock); 
-    if (c == "2")
-        driver_client(sock);
-    User user;
     while (true)
     {
-        sendPrompt(sock, "\n---------- MAIN MENU ----------\n1. Register\n2. Login\n3. Exit\nChoose: PROMPT@");
-        string choice = receiveInput(sock);
-
-        if (choice == "3")
-            break;
-
-        if (choice == "1")
+        int sock = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (sock < 0)
         {
-            user.registerUser(sock);
-            sendMessage(sock, "Please login to continue...\n");
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                logger.log(LOG_ERROR, string("❌ accept: ") + strerror(errno));
+            return;
         }
 
-        string uid = user.login(sock);
-        if (uid.empty())
-            continue;
+        // Set socket options for the client connection
+        int flag = 1;
+        setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, &flag, sizeof(flag));
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
 
-        ReservationHandler handler(uid);
-        while (true)
+        auto session = make_shared<Session>(sock, epfd, listener.blankLines);
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = sock;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, sock, &ev) < 0)
         {
-            sendPrompt(sock, "\n---------- DASHBOARD ----------\n1. View Ticket\n2. Reserve Ticket\n3. Logout\nChoose: PROMPT@");
-            string action = receiveInput(sock);
-            if (action == "1")
-                handler.viewTickets(sock);
-            else if (action == "2")
-                handler.reserve(sock);
-            else if (action == "3")
-                break;
-            else
-            {
-                sendMessage(sock, "Oops! you mistyped. Try again");
-                continue;
-            }
+            logger.log(LOG_ERROR, string("❌ epoll_ctl: ") + strerror(errno));
+            continue; // the session closes the socket
         }
+        sessions[sock] = session;
+
+        Session *s = session.get();
+        Dialogue dialogue = listener.dialogue;
+        s->post([s, dialogue] { s->run(dialogue(*s)); });
     }
-    close(sock);
 }
 
-// --- MAIN ---
+void Reactor::drop(int fd)
+{
+    epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+    sessions[fd]->drop();
+    sessions.erase(fd); // the socket closes once no worker holds the session
+}
 
 // ---------- UDP Broadcast Function ----------
 void broadcastServerIP()
@@ -1611,47 +5675,92 @@ void broadcastServerIP()
     {
         sendto(udp_socket, message.c_str(), message.length(), 0,
                (sockaddr *)&broadcast_addr, sizeof(broadcast_addr));
-        cout << "[Broadcasting] " << message << "\n";
+        logger.log(LOG_INFO, "[Broadcasting] " + message);
         sleep(10);
     }
 }
 
+// ---------- TCP Listener ----------
+int openListener(int port, in_addr_t host = INADDR_ANY)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int flag = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(host);
+    address.sin_port = htons(port);
+
+    if (bind(fd, (sockaddr *)&address, sizeof(address)) < 0 || listen(fd, SOMAXCONN) < 0)
+    {
+        logger.log(LOG_ERROR, "❌ port " + to_string(port) + ": " + strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
 // ---------- Main Function ----------
-int main()
+// bench.cpp includes this file to reach the internals, so it brings its own main
+// Startup: every store from the data files in the working directory, with
+// seats.bin brought in line with bookings.txt. False if the server cannot run.
+bool loadStores()
 {
+    tripStore.load(TRIPS_FILE);
+    if (!seatStore.open(SEAT_FILE))
+        return false;
+    seatStore.importLegacy(tripStore.all());
+    if (!bookingLog.open(BOOKING_FILE))   // drops a torn last row before anything reads the file
+        return false;
+    bookingIndex.load(BOOKING_FILE);
+    seatStore.reconcile(bookingIndex);
+    identities.load(USER_FILE, DRIVER_FILE);
+    return true;
+}
+
+#ifndef BUS_SERVER_NO_MAIN
+int main(int argc, char *argv[])
+{
+    // --trace logs every message sent and received, --spans starts span tracing
+    for (int i = 1; i < argc; ++i)
+    {
+        if (string(argv[i]) == "--trace")
+            logger.setLevel(LOG_TRACE);
+        if (string(argv[i]) == "--spans")
+            spans.enable(true);
+    }
+    logger.start();
+
     // Start UDP broadcasting
     thread broadcaster(broadcastServerIP);
     broadcaster.detach();
 
-    // Setup TCP server
-    int server_fd, new_sock;
-    struct sockaddr_in address;
-    int addrlen = sizeof(address);
-
-    server_fd = socket(AF_INET, SOCK_STREAM, 0);
-    // Add these socket options
-int flag = 1;
-setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
-setsockopt(server_fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
-    address.sin_family = AF_INET;
-    address.sin_addr.s_addr = INADDR_ANY;
-    address.sin_port = htons(TCP_PORT);
+    // Setup TCP servers: the menus, the machine API and the local admin port
+    int server_fd = openListener(TCP_PORT);
+    int api_fd = openListener(API_PORT);
+    int admin_fd = openListener(ADMIN_PORT, INADDR_LOOPBACK);
+    if (server_fd < 0 || api_fd < 0 || admin_fd < 0)
+        return 1;
 
-    bind(server_fd, (struct sockaddr *)&address, sizeof(address));
-    listen(server_fd, 3);
+    if (!loadStores())
+        return 1;
 
     cout << "✅ Server is running on port " << TCP_PORT << " and broadcasting..." << endl;
+    cout << "✅ Machine API on port " << API_PORT << endl;
+    cout << "✅ Metrics on 127.0.0.1:" << ADMIN_PORT << endl;
 
-    // Accept multiple clients
-    while (true)
-    {
-        new_sock = accept(server_fd, (struct sockaddr *)&address, (socklen_t *)&addrlen);
-         // Set socket options for the client connection
-    int flag = 1;
-    setsockopt(new_sock, SOL_SOCKET, SO_KEEPALIVE, &flag, sizeof(flag));
-    setsockopt(new_sock, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
-        thread(handle_client, new_sock).detach();
-    }
+    // Workers still sit out the fsyncs of new identities and trips, so keep a few spare
+    workers.start(max(4u, thread::hardware_concurrency() * 2));
+
+    // Accept and serve every client from one epoll loop
+    Reactor reactor;
+    if (!reactor.open() || !reactor.listen(server_fd, handle_client) || !reactor.listen(api_fd, api_client) ||
+        !reactor.listen(admin_fd, admin_client, true))
+        return 1;
+    reactor.run();
 
     return 0;
 }
+#endif
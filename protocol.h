@@ -0,0 +1,90 @@
+// Wire protocol shared by newserver.cpp and cmine.cpp
+//
+// A connection starts in the old text mode: the server writes plain text and
+// ends every question with PROMPT@, and the client answers with one line.
+// A framed client opts out of that by sending a single NUL byte followed by a
+// HELLO frame as soon as it connects. The server answers with its own NUL
+// byte (text never contains one, so the client can throw away whatever text
+// arrived before it), and from then on both sides only send frames:
+//
+//   +--------+-----------------------+-----------------+
+//   | type   | length (uint32, BE)   | payload         |
+//   | 1 byte | 4 bytes               | length bytes    |
+//   +--------+-----------------------+-----------------+
+//
+// The payload is UTF-8 text. A PROMPT is a MESSAGE that expects exactly one
+// INPUT frame in reply. Nothing is drained, resynchronised or timed. A
+// NOTICE can arrive at any time, even while a PROMPT is waiting for its
+// answer, and needs no reply.
+#ifndef BUS_RESERVATION_PROTOCOL_H
+#define BUS_RESERVATION_PROTOCOL_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+const char FRAME_SYNC = '\0';
+const size_t FRAME_HEADER_SIZE = 5;
+const char PROTOCOL_VERSION[] = "1";
+
+enum FrameType : char
+{
+    // client -> server
+    FRAME_HELLO = 'H',   // payload: protocol version
+    FRAME_INPUT = 'I',   // payload: the answer to the last PROMPT
+    FRAME_BYE = 'B',     // client is leaving
+
+    // server -> client
+    FRAME_MESSAGE = 'M', // payload: text to show
+    FRAME_PROMPT = 'P',  // payload: question to show; reply with FRAME_INPUT
+    FRAME_NOTICE = 'N',  // payload: unsolicited update (may arrive while a PROMPT is open)
+};
+
+inline void encodeFrameHeader(char type, uint32_t n, char header[FRAME_HEADER_SIZE])
+{
+    header[0] = type;
+    header[1] = char(n >> 24);
+    header[2] = char(n >> 16);
+    header[3] = char(n >> 8);
+    header[4] = char(n);
+}
+
+inline std::string encodeFrame(char type, const std::string &payload)
+{
+    char header[FRAME_HEADER_SIZE];
+    encodeFrameHeader(type, payload.size(), header);
+    std::string frame;
+    frame.reserve(FRAME_HEADER_SIZE + payload.size());
+    frame.append(header, FRAME_HEADER_SIZE);
+    frame += payload;
+    return frame;
+}
+
+enum FrameStatus
+{
+    FRAME_READY,     // type and payload filled in, pos moved past the frame
+    FRAME_PARTIAL,   // need more bytes
+    FRAME_TOO_LARGE, // length exceeds maxPayload
+};
+
+// Decode the frame that starts at buf[pos]
+inline FrameStatus decodeFrame(const std::string &buf, size_t &pos, size_t maxPayload,
+                               char &type, std::string &payload)
+{
+    if (buf.size() - pos < FRAME_HEADER_SIZE)
+        return FRAME_PARTIAL;
+
+    const unsigned char *h = reinterpret_cast<const unsigned char *>(buf.data() + pos);
+    uint32_t n = (uint32_t(h[1]) << 24) | (uint32_t(h[2]) << 16) | (uint32_t(h[3]) << 8) | h[4];
+    if (n > maxPayload)
+        return FRAME_TOO_LARGE;
+    if (buf.size() - pos - FRAME_HEADER_SIZE < n)
+        return FRAME_PARTIAL;
+
+    type = char(h[0]);
+    payload.assign(buf, pos + FRAME_HEADER_SIZE, n);
+    pos += FRAME_HEADER_SIZE + n;
+    return FRAME_READY;
+}
+
+#endif